@@ -0,0 +1,33 @@
+#!/bin/sh
+# variable lookup from inside nested fns. a million loop iterations read
+# a variable bound 1, 8 and 32 fns further out. closures capture what
+# they use into a frame of their own, so the time shouldn't grow with
+# the nesting. run from the repo root after make, options after the scc
+# binary are passed on to it:
+#   ./bench/closure.sh [./scc [--engine=vm]]
+scc=${1:-./scc}
+[ $# -gt 0 ] && shift
+dir=$(mktemp -d)
+trap 'rm -rf "$dir"' EXIT
+
+for depth in 1 8 32; do
+    awk -v depth="$depth" 'BEGIN {
+        printf "let make = fn (v) ->"
+        for (i = 1; i < depth; i++) printf " fn (a%d) ->", i
+        print " fn () -> do"
+        print "  let loop = fn (i, acc) ->"
+        print "    if i == 0 then acc else loop(i - 1, acc + v + v + v + v);"
+        print "  let run = fn (k, acc) ->"
+        print "    if k == 0 then acc else run(k - 1, acc + loop(10000, 0));"
+        print "  run(100, 0);"
+        print "done"
+        print "let f1 = make(1)"
+        for (i = 1; i < depth; i++) print "let f" i + 1 " = f" i "(" i ")"
+        print "puts(f" depth "())"
+    }' > "$dir/closure$depth.scc"
+
+    start=$(date +%s%N)
+    "$scc" "$@" "$dir/closure$depth.scc"
+    end=$(date +%s%N)
+    echo "depth $depth: $(( (end - start) / 1000000 )) ms"
+done
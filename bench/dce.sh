@@ -0,0 +1,36 @@
+#!/bin/sh
+# startup time and size of the transpiled ocaml for a large generated
+# script whose lets are mostly never read, and whose blocks evaluate
+# forms nothing uses. compared with --no-opt, which keeps all of it. run
+# from the repo root after make:
+#   ./bench/dce.sh [./scc [./tscc [scc options]]]
+scc=${1:-./scc}
+tscc=${2:-./tscc}
+shift $(( $# < 2 ? $# : 2 ))
+dir=$(mktemp -d)
+trap 'rm -rf "$dir"' EXIT
+
+# 20000 constants and 20000 fns, of which every hundredth is used
+awk 'BEGIN {
+    for (i = 0; i < 20000; i++) {
+        print "let c" i " = " i " * 3 + 1"
+        print "let f" i " = fn (a, b) -> do"
+        print "  a * " i " + b;"
+        print "  b - a;"
+        print "  if a < b then a else b;"
+        print "done"
+    }
+    printf "let total = 0"
+    for (i = 0; i < 20000; i += 100) printf " + f%d(c%d, %d)", i, i, i
+    print ""
+    print "puts(total)"
+}' > "$dir/dead.scc"
+
+for mode in --no-opt ""; do
+    echo "${mode:-optimized}:"
+    start=$(date +%s%N)
+    "$scc" "$@" $mode "$dir/dead.scc"
+    end=$(date +%s%N)
+    echo "time: $(( (end - start) / 1000000 )) ms"
+    echo "ocaml: $("$tscc" $mode --print-ml "$dir/dead.scc" | wc -c) bytes"
+done
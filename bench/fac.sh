@@ -0,0 +1,32 @@
+#!/bin/sh
+# examples/fac.scc scaled up: 200 runs of fac(5000), a million calls
+# 5000 deep. run from the repo root after make, options after the scc
+# binary are passed on to it:
+#   ./bench/fac.sh [./scc [--engine=vm]]
+scc=${1:-./scc}
+[ $# -gt 0 ] && shift
+dir=$(mktemp -d)
+trap 'rm -rf "$dir"' EXIT
+
+cat > "$dir/fac.scc" <<'SCC'
+let fac = fn (n) ->
+  if n <= 1 then 1
+  else n * fac(n - 1)
+
+let loop = fn (k) -> if k == 0 then 0 else do
+  fac(5000);
+  loop(k - 1);
+done
+
+puts(loop(200))
+SCC
+
+# max rss is only reported where gnu time is installed
+if [ -x /usr/bin/time ]; then
+    /usr/bin/time -f "time: %e s\nmax rss: %M KB" "$scc" "$@" "$dir/fac.scc"
+else
+    start=$(date +%s%N)
+    "$scc" "$@" "$dir/fac.scc"
+    end=$(date +%s%N)
+    echo "time: $(( (end - start) / 1000000 )) ms"
+fi
@@ -0,0 +1,36 @@
+#!/bin/sh
+# a long running script that makes closures, captured frames and strings
+# it drops right away, a million of each. with --gc-stats the collector
+# reports its pauses and how much it freed. run from the repo root after
+# make, options after the scc binary are passed on to it:
+#   ./bench/gc.sh [./scc [--engine=vm] [--gc-growth=F] [--gc-heap=KB]]
+scc=${1:-./scc}
+[ $# -gt 0 ] && shift
+dir=$(mktemp -d)
+trap 'rm -rf "$dir"' EXIT
+
+cat > "$dir/gc.scc" <<'SCC'
+let adder = fn (n) -> fn (m) -> n + m
+let label = fn (n) -> if n % 2 == 0 then "even" else "odd"
+
+let inner = fn (k, acc) -> if k == 0 then acc else do
+  let add = adder(k);
+  inner(k - 1, acc + add(1) + (label(k) == "odd"));
+done
+
+let outer = fn (k, acc) -> if k == 0 then acc else
+  outer(k - 1, acc + inner(1000, 0))
+
+puts(outer(1000, 0))
+SCC
+
+# max rss is only reported where gnu time is installed
+if [ -x /usr/bin/time ]; then
+    /usr/bin/time -f "time: %e s\nmax rss: %M KB" \
+        "$scc" --gc-stats "$@" "$dir/gc.scc"
+else
+    start=$(date +%s%N)
+    "$scc" --gc-stats "$@" "$dir/gc.scc"
+    end=$(date +%s%N)
+    echo "time: $(( (end - start) / 1000000 )) ms"
+fi
@@ -0,0 +1,21 @@
+#!/bin/sh
+# variable lookup in a global scope of 10000 bindings. the loop reads
+# the first ones bound, which a list of bindings keeps at its far end.
+# run from the repo root after make:
+#   ./bench/globals.sh [./scc]
+scc=${1:-./scc}
+dir=$(mktemp -d)
+trap 'rm -rf "$dir"' EXIT
+
+awk 'BEGIN {
+    for (i = 0; i < 10000; i++) print "let g" i " = " i
+    print "let sum = fn (n, acc) -> if n == 0 then acc"
+    print "    else sum(n - 1, acc + g0 + g1 + g2 + g3 + g4 + g5 + g6 + g7)"
+    print "let run = fn (k) -> if k == 0 then 0 else sum(1000, 0) + run(k - 1)"
+    print "puts(run(20))"
+}' > "$dir/globals.scc"
+
+start=$(date +%s%N)
+"$scc" "$dir/globals.scc"
+end=$(date +%s%N)
+echo "time: $(( (end - start) / 1000000 )) ms"
@@ -0,0 +1,28 @@
+#!/bin/sh
+# calls of small helpers, square and abs from examples/fns.scc, a million
+# times in a loop. run with the default inline budget and with none,
+# which keeps every call. run from the repo root after make, options
+# after the scc binary are passed on to it:
+#   ./bench/inline.sh [./scc [--engine=vm]]
+scc=${1:-./scc}
+[ $# -gt 0 ] && shift
+dir=$(mktemp -d)
+trap 'rm -rf "$dir"' EXIT
+
+cat > "$dir/inline.scc" <<'SCC'
+let square = fn (n) -> n * n
+let abs = fn (n) -> if n < 0 then -n else n
+let loop = fn (i, acc) ->
+  if i == 0 then acc
+  else loop(i - 1, acc + square(abs(i % 7 - 3)))
+let run = fn (k, acc) ->
+  if k == 0 then acc else run(k - 1, acc + loop(10000, 0))
+puts(run(100, 0))
+SCC
+
+for budget in 12 0; do
+    start=$(date +%s%N)
+    "$scc" "$@" --inline-budget=$budget "$dir/inline.scc"
+    end=$(date +%s%N)
+    echo "budget $budget: $(( (end - start) / 1000000 )) ms"
+done
@@ -0,0 +1,23 @@
+#!/bin/sh
+# a million steps of a hash over ints, whose products pass the 49 bits
+# of an int that fits in a value and are boxed, and of the same loop over
+# doubles, which round once past 2^53 and print another result. run from
+# the repo root after make, options after the scc binary are passed on:
+#   ./bench/int.sh [./scc [--engine=vm]]
+scc=${1:-./scc}
+[ $# -gt 0 ] && shift
+dir=$(mktemp -d)
+trap 'rm -rf "$dir"' EXIT
+
+for kind in int double; do
+    if [ "$kind" = int ]; then one=1; else one=1.0; fi
+    cat > "$dir/$kind.scc" <<SCC
+let step = fn (x) -> (x * 6364136223 + 1442695040888963) % 1000000007
+let loop = fn (i, x) -> if i == 0 then x else loop(i - $one, step(x))
+puts(loop(1000000, $one))
+SCC
+    start=$(date +%s%N)
+    "$scc" "$@" "$dir/$kind.scc"
+    end=$(date +%s%N)
+    echo "$kind: $(( (end - start) / 1000000 )) ms"
+done
@@ -0,0 +1,30 @@
+#!/bin/sh
+# startup time of a large generated library that only calls one of its
+# functions, parsed fully and with lazy fn bodies. run from the repo
+# root after make:
+#   ./bench/lazy.sh [./scc]
+scc=${1:-./scc}
+dir=$(mktemp -d)
+trap 'rm -rf "$dir"' EXIT
+
+# 20000 functions with bodies of a few hundred tokens each
+awk 'BEGIN {
+    for (f = 0; f < 20000; f++) {
+        print "let f" f " = fn (a, b) -> do"
+        for (i = 0; i < 10; i++) {
+            print "  let x" i " = if a < " i " then a * b - " i \
+                  " else (b + " i ") % (a + 1);"
+        }
+        print "  a + b;"
+        print "done"
+    }
+    print "puts(f0(2, 3))"
+}' > "$dir/lib.scc"
+
+for mode in "" --lazy; do
+    echo "${mode:-full}:"
+    start=$(date +%s%N)
+    "$scc" $mode "$dir/lib.scc"
+    end=$(date +%s%N)
+    echo "time: $(( (end - start) / 1000000 )) ms"
+done
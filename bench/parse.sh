@@ -0,0 +1,38 @@
+#!/bin/sh
+# parser throughput on generated expressions. run from the repo root
+# after make, optionally with the scc binary to measure:
+#   ./bench/parse.sh [./scc]
+scc=${1:-./scc}
+dir=$(mktemp -d)
+trap 'rm -rf "$dir"' EXIT
+
+# long flat expressions, 200 lines of 5000 operands mixing every
+# binary operator and some unary ones
+awk 'BEGIN {
+    split("+ - * / % < > <= >= == != and or", ops, " ")
+    for (f = 0; f < 200; f++) {
+        line = "1"
+        for (i = 1; i < 5000; i++) {
+            operand = i % 7 == 0 ? "-x" : i % 11 == 0 ? "!y" : i
+            line = line " " ops[i % 13 + 1] " " operand
+        }
+        print line
+    }
+}' > "$dir/flat.scc"
+
+# deeply nested expressions, 200 lines nested 2000 parentheses deep
+awk 'BEGIN {
+    split("+ - * / % < > <= >= == != and or", ops, " ")
+    for (f = 0; f < 200; f++) {
+        line = ""
+        for (i = 0; i < 2000; i++) line = line i " " ops[i % 13 + 1] " ("
+        line = line "x"
+        for (i = 0; i < 2000; i++) line = line ")"
+        print line
+    }
+}' > "$dir/nested.scc"
+
+for name in flat nested; do
+    echo "$name:"
+    "$scc" --parse-only "$dir/$name.scc" | grep -E "nodes|time|throughput"
+done
@@ -0,0 +1,46 @@
+#!/bin/sh
+# ten million self tail calls and a million mutually recursive ones, in
+# both engines. with proper tail calls neither grows the c stack nor the
+# frame stack, so they run under --max-depth=1000. exits non zero when
+# an engine fails or prints something else than expected. run from the
+# repo root after make, options after the scc binary are passed on to it:
+#   ./bench/tail.sh [./scc [options]]
+scc=${1:-./scc}
+[ $# -gt 0 ] && shift
+dir=$(mktemp -d)
+trap 'rm -rf "$dir"' EXIT
+
+cat > "$dir/tail.scc" <<'SCC'
+let loop = fn (n, acc) -> if n == 0 then acc else loop(n - 1, acc + 1)
+puts(loop(10000000, 0))
+
+let even = fn (n) -> if n == 0 then true else odd(n - 1)
+let odd = fn (n) -> if n == 0 then false else even(n - 1)
+puts(even(1000000))
+SCC
+
+printf '10000000\ntrue\n' > "$dir/expected"
+
+status=0
+for engine in tree vm; do
+    echo "$engine:"
+    run="$scc --engine=$engine --max-depth=1000 $* $dir/tail.scc"
+    # max rss is only reported where gnu time is installed
+    if [ -x /usr/bin/time ]; then
+        /usr/bin/time -f "time: %e s\nmax rss: %M KB" -o "$dir/time" \
+            $run > "$dir/out"
+        code=$?
+    else
+        start=$(date +%s%N)
+        $run > "$dir/out"
+        code=$?
+        end=$(date +%s%N)
+        echo "time: $(( (end - start) / 1000000 )) ms" > "$dir/time"
+    fi
+    cat "$dir/out" "$dir/time"
+    if [ $code -ne 0 ] || ! cmp -s "$dir/out" "$dir/expected"; then
+        echo "$engine: FAILED, expected 10000000 and true"
+        status=1
+    fi
+done
+exit $status
@@ -0,0 +1,25 @@
+#!/bin/sh
+# arithmetic and comparisons on numbers in a loop of two million steps,
+# with operators specialised to the types inferred and with --no-types,
+# which checks what every operand is. run from the repo root after make,
+# options after the scc binary are passed on to it:
+#   ./bench/types.sh [./scc [--engine=vm]]
+scc=${1:-./scc}
+[ $# -gt 0 ] && shift
+dir=$(mktemp -d)
+trap 'rm -rf "$dir"' EXIT
+
+cat > "$dir/types.scc" <<'SCC'
+let step = fn (x) -> if x % 2 == 0 then x / 2 else 3 * x + 1
+let loop = fn (i, x, acc) ->
+  if i == 0 then acc
+  else loop(i - 1, if x <= 1 then i else step(x), acc + -x % 7)
+puts(loop(2000000, 27, 0))
+SCC
+
+for types in "" --no-types; do
+    start=$(date +%s%N)
+    "$scc" "$@" $types "$dir/types.scc"
+    end=$(date +%s%N)
+    echo "${types:-types}: $(( (end - start) / 1000000 )) ms"
+done
@@ -0,0 +1,78 @@
+#include <stdlib.h>
+#include <string.h>
+#include "arena.h"
+
+// default block size, larger allocations get a block of their own
+#define ARENA_BLOCK (64 * 1024)
+#define ARENA_ALIGN 8
+
+Arena *arena_create(void) {
+    Arena *arena = malloc(sizeof(struct Arena));
+
+    arena->blocks = NULL;
+    arena->allocations = 0;
+    arena->bytes = 0;
+    arena->block_count = 0;
+
+    return arena;
+}
+
+// start a new block that fits at least 'size' bytes
+static void arena_grow(Arena *self, size_t size) {
+    size_t block_size = size > ARENA_BLOCK ? size : ARENA_BLOCK;
+    struct ArenaBlock *block = malloc(sizeof(struct ArenaBlock) + block_size);
+
+    block->next = self->blocks;
+    block->size = block_size;
+    block->used = 0;
+
+    self->blocks = block;
+    self->block_count++;
+}
+
+void *arena_alloc(Arena *self, size_t size) {
+    size = (size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+
+    if (self->blocks == NULL ||
+        self->blocks->size - self->blocks->used < size) {
+        arena_grow(self, size);
+    }
+
+    void *ptr = self->blocks->data + self->blocks->used;
+    self->blocks->used += size;
+
+    self->allocations++;
+    self->bytes += size;
+    return ptr;
+}
+
+char *arena_strndup(Arena *self, const char *string, size_t length) {
+    char *copy = arena_alloc(self, length + 1);
+
+    memcpy(copy, string, length);
+    copy[length] = '\0';
+
+    return copy;
+}
+
+int arena_contains(Arena *self, void *ptr) {
+    for (struct ArenaBlock *block = self->blocks; block; block = block->next) {
+        if ((char *)ptr >= block->data &&
+            (char *)ptr < block->data + block->used) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+void arena_destroy(Arena *self) {
+    struct ArenaBlock *block = self->blocks;
+
+    while (block != NULL) {
+        struct ArenaBlock *next = block->next;
+        free(block);
+        block = next;
+    }
+
+    free(self);
+}
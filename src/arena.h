@@ -0,0 +1,36 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+// block of an arena, allocations are bumped out of data
+struct ArenaBlock {
+    struct ArenaBlock *next;
+    size_t size;
+    size_t used;
+    _Alignas(16) char data[];
+};
+
+// bump pointer arena. everything allocated from it is released at once
+// by arena_destroy
+typedef struct Arena {
+    struct ArenaBlock *blocks;
+    // counters for comparing allocation throughput
+    long allocations;
+    size_t bytes;
+    long block_count;
+} Arena;
+
+// create an empty arena
+Arena *arena_create(void);
+// allocate 'size' bytes aligned to 8 bytes, enough for the pointers,
+// doubles and int64_ts of the nodes, not for long double
+void *arena_alloc(Arena *self, size_t size);
+// copy 'length' bytes of a string into the arena, null terminated
+char *arena_strndup(Arena *self, const char *string, size_t length);
+// check if a pointer was allocated from the arena
+int arena_contains(Arena *self, void *ptr);
+// free the arena and everything allocated from it
+void arena_destroy(Arena *self);
+
+#endif
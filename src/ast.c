@@ -1,142 +1,289 @@
 #include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
 #include "ast.h"
 
+// size of a node that only uses payload 'member'
+#define AST_SIZE(member) \
+    (offsetof(struct AstNode, member) + sizeof(((AstNode *)0)->member))
+
+// arena new nodes go to, NULL allocates them with malloc
+static Arena *ast_arena = NULL;
+static AstStats stats = {0, 0};
+
+Arena *ast_set_arena(Arena *arena) {
+    Arena *previous = ast_arena;
+    ast_arena = arena;
+    return previous;
+}
+
+AstStats ast_stats(void) {
+    return stats;
+}
+
+size_t ast_node_size(int type) {
+    switch (type) {
+        case AST_NUMBER:
+        case AST_INTEGER:
+        case AST_STRING:
+        case AST_BOOL:
+        case AST_NIL:        return AST_SIZE(value);
+        case AST_VAR:        return AST_SIZE(var);
+        case AST_BINOP:      return AST_SIZE(binop);
+        case AST_UNOP:       return AST_SIZE(unop);
+        case AST_ASSIGNMENT: return AST_SIZE(assign);
+        case AST_IF:         return AST_SIZE(if_expr);
+        case AST_FN:         return AST_SIZE(fn);
+        case AST_FNCALL:     return AST_SIZE(fncall);
+        case AST_BLOCK:      return AST_SIZE(block);
+        default:             return offsetof(struct AstNode, value);
+    }
+}
+
+// allocate a zeroed node of 'type' from the current arena
+static AstNode *ast_alloc(int type) {
+    size_t size = ast_node_size(type);
+    AstNode *node;
+
+    stats.nodes++;
+    stats.bytes += size;
+
+    if (ast_arena != NULL) {
+        node = arena_alloc(ast_arena, size);
+    } else {
+        node = malloc(size);
+    }
+
+    memset(node, 0, size);
+    node->type = type;
+    return node;
+}
+
+// allocate an array of 'count' node pointers from the current arena
+static AstNode **ast_alloc_list(int count) {
+    size_t size = count * sizeof(struct AstNode *);
+
+    if (ast_arena != NULL) return arena_alloc(ast_arena, size);
+    return malloc(size);
+}
+
+char *ast_strndup(const char *string, size_t length) {
+    if (ast_arena != NULL) return arena_strndup(ast_arena, string, length);
+    return strndup(string, length);
+}
+
 AstNode *ast_init_num(double num) {
-    AstNode *node = malloc(sizeof(struct AstNode));
+    AstNode *node = ast_alloc(AST_NUMBER);
 
-    node->type = AST_NUMBER;
     node->value.num_value = num;
 
     return node;
 }
 
+AstNode *ast_init_int(int64_t integer) {
+    AstNode *node = ast_alloc(AST_INTEGER);
+
+    node->value.int_value = integer;
+
+    return node;
+}
+
 AstNode *ast_init_str(char *string) {
-    AstNode *node = malloc(sizeof(struct AstNode));
+    AstNode *node = ast_alloc(AST_STRING);
 
-    node->type = AST_STRING;
     node->value.str_value = string;
 
     return node;
 }
 
 AstNode *ast_init_bool(int truth) {
-    AstNode *node = malloc(sizeof(struct AstNode));
+    AstNode *node = ast_alloc(AST_BOOL);
 
-    node->type = AST_BOOL;
     node->value.bool_value = truth == 1;
 
     return node;
 }
 
 AstNode *ast_init_nil(void) {
-    AstNode *node = malloc(sizeof(struct AstNode));
+    AstNode *node = ast_alloc(AST_NIL);
 
-    node->type = AST_NIL;
     node->value.nil = NULL;
 
     return node;
 }
 
 AstNode *ast_init_var(char *name, Token token) {
-    AstNode *node = malloc(sizeof(struct AstNode));
+    AstNode *node = ast_alloc(AST_VAR);
 
-    node->type = AST_VAR;
-    node->token = token;
-    node->value.ident_name = name;
+    node->line = token.line;
+    node->var.name = name;
+    node->var.depth = VAR_GLOBAL;
 
     return node;
 }
 
 AstNode *ast_init_unop(AstNode *right, Token op) {
-    AstNode *node = malloc(sizeof(struct AstNode));
-    
-    node->type = AST_UNOP;
-    node->right = right;
-    node->op = op;
+    AstNode *node = ast_alloc(AST_UNOP);
+
+    node->line = op.line;
+    node->unop.right = right;
+    node->unop.op = op.type;
 
     return node;
 }
 
 AstNode *ast_init_binop(AstNode *left, AstNode *right, Token op) {
-    AstNode *node = malloc(sizeof(struct AstNode));
-    
-    node->type = AST_BINOP;
-    node->left = left;
-    node->right = right;
-    node->op = op;
+    AstNode *node = ast_alloc(AST_BINOP);
+
+    node->line = op.line;
+    node->binop.left = left;
+    node->binop.right = right;
+    node->binop.op = op.type;
 
     return node;
 }
 
 AstNode *ast_init_assign(AstNode *left, AstNode *right, Token op) {
-    AstNode *node = malloc(sizeof(struct AstNode));
-    
-    node->type = AST_ASSIGNMENT;
-    node->left = left;
-    node->right = right;
-    node->op = op;
+    AstNode *node = ast_alloc(AST_ASSIGNMENT);
+
+    node->line = op.line;
+    node->assign.left = left;
+    node->assign.right = right;
 
     return node;
 }
 
 AstNode *ast_init_if(AstNode *cond, AstNode *then, AstNode *alter) {
-    AstNode *node = malloc(sizeof(struct AstNode));
+    AstNode *node = ast_alloc(AST_IF);
 
-    node->type = AST_IF;
-    node->condition = cond;
-    node->then_branch = then;
-    node->else_branch = alter;
+    node->line = cond->line;
+    node->if_expr.condition = cond;
+    node->if_expr.then_branch = then;
+    node->if_expr.else_branch = alter;
 
     return node;
 }
 
 AstNode *ast_init_block(AstNode **children, int child_count) {
-    AstNode *node = malloc(sizeof(struct AstNode));
+    AstNode *node = ast_alloc(AST_BLOCK);
 
-    node->type = AST_BLOCK;
-    node->children = children;
-    node->child_count = child_count;
+    node->block.children = children;
+    node->block.child_count = child_count;
 
     return node;
 }
 
 AstNode *ast_init_fn(AstNode **params, int param_count, AstNode *body) {
-    AstNode *node = malloc(sizeof(struct AstNode));
+    AstNode *node = ast_alloc(AST_FN);
 
-    node->type = AST_FN;
-    node->params = params;
-    node->param_count = param_count;
-    node->body = body;
+    node->line = body->line;
+    node->fn.params = params;
+    node->fn.param_count = param_count;
+    node->fn.body = body;
+
+    return node;
+}
+
+AstNode *ast_init_lazy_fn(
+    AstNode **params, int param_count, struct LazyBody *lazy, int line) {
+    AstNode *node = ast_alloc(AST_FN);
+
+    node->line = line;
+    node->fn.params = params;
+    node->fn.param_count = param_count;
+    node->fn.lazy = lazy;
 
     return node;
 }
 
 AstNode *ast_init_fncall(
     char *fn_name, AstNode **args, int arg_count, AstNode *lambda) {
-    AstNode *node = malloc(sizeof(struct AstNode));
+    AstNode *node = ast_alloc(AST_FNCALL);
 
-    node->type = AST_FNCALL;
-    node->value.ident_name = fn_name;
-    node->args = args;
-    node->arg_count = arg_count;
-    node->lambda = lambda;
+    node->line = lambda->line;
+    node->fncall.name = fn_name;
+    node->fncall.args = args;
+    node->fncall.arg_count = arg_count;
+    node->fncall.lambda = lambda;
 
     return node;
 }
 
 AstNode *ast_init_noop(void) {
-    AstNode *node = malloc(sizeof(struct AstNode));
-    node->type = AST_NOOP;
-    return node;
+    return ast_alloc(AST_NOOP);
 }
 
-AstNode *ast_init_cfn(char *name, Builtin cfun_ptr) {
-    AstNode *node = malloc(sizeof(struct AstNode));
+AstNode **ast_init_list(AstNode **nodes, int count) {
+    AstNode **list = ast_alloc_list(count);
+    if (count > 0) memcpy(list, nodes, count * sizeof(struct AstNode *));
+    return list;
+}
 
-    node->type = AST_CFN;
-    node->value.ident_name = name;
-    node->cfun_ptr = cfun_ptr;
+// copy a list of nodes with ast_copy
+static AstNode **ast_copy_list(AstNode **nodes, int count, Arena *from) {
+    AstNode **list = ast_alloc_list(count);
 
-    return node;
+    for (int i = 0; i < count; i++) list[i] = ast_copy(nodes[i], from);
+    return list;
 }
 
+// copy the captures of a fn, if they live in arena 'from'
+static Capture *ast_copy_captures(Capture *captures, int count, Arena *from) {
+    if (captures == NULL || !arena_contains(from, captures)) return captures;
+
+    size_t size = count * sizeof(struct Capture);
+    Capture *copy = ast_arena != NULL ? arena_alloc(ast_arena, size)
+                                      : malloc(size);
+    memcpy(copy, captures, size);
+    return copy;
+}
+
+AstNode *ast_copy(AstNode *node, Arena *from) {
+    if (node == NULL || !arena_contains(from, node)) return node;
+
+    AstNode *copy = ast_alloc(node->type);
+    memcpy(copy, node, ast_node_size(node->type));
+
+    switch (node->type) {
+        case AST_STRING:
+            copy->value.str_value = ast_strndup(
+                node->value.str_value, strlen(node->value.str_value));
+            break;
+        case AST_UNOP:
+            copy->unop.right = ast_copy(node->unop.right, from);
+            break;
+        case AST_BINOP:
+            copy->binop.left = ast_copy(node->binop.left, from);
+            copy->binop.right = ast_copy(node->binop.right, from);
+            break;
+        case AST_ASSIGNMENT:
+            copy->assign.left = ast_copy(node->assign.left, from);
+            copy->assign.right = ast_copy(node->assign.right, from);
+            break;
+        case AST_IF:
+            copy->if_expr.condition = ast_copy(node->if_expr.condition, from);
+            copy->if_expr.then_branch = ast_copy(
+                node->if_expr.then_branch, from);
+            copy->if_expr.else_branch = ast_copy(
+                node->if_expr.else_branch, from);
+            break;
+        case AST_BLOCK:
+            copy->block.children = ast_copy_list(
+                node->block.children, node->block.child_count, from);
+            break;
+        case AST_FN:
+            copy->fn.params = ast_copy_list(
+                node->fn.params, node->fn.param_count, from);
+            copy->fn.captures = ast_copy_captures(
+                node->fn.captures, node->fn.capture_count, from);
+            copy->fn.body = ast_copy(node->fn.body, from);
+            break;
+        case AST_FNCALL:
+            copy->fncall.args = ast_copy_list(
+                node->fncall.args, node->fncall.arg_count, from);
+            copy->fncall.lambda = ast_copy(node->fncall.lambda, from);
+            break;
+    }
+
+    return copy;
+}
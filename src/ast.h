@@ -1,69 +1,145 @@
 #ifndef AST_H
 #define AST_H
 
+#include <stdint.h>
 #include "lexer.h"
+#include "arena.h"
 
-// type for builtin functions
-typedef struct AstNode *(*Builtin) (int, struct AstNode **);
+// where the body of a lazily parsed fn starts, defined by the parser
+struct LazyBody;
 
-// structure of ast node
+// a variable a fn captures when its closure is made: the value in slot
+// 'slot' of the frame 'depth' parents up from where the fn is evaluated.
+// 'cell' is set when the variable lives in a cell, see value.h
+typedef struct Capture {
+    int depth;
+    int slot;
+    int cell;
+} Capture;
+
+// structure of ast node, a small header and a payload for each node type.
+// nodes are allocated with just the size of their own payload, so a
+// literal takes 16 bytes and a variable 32. nodes are only code, what a
+// program computes is a Value, see value.h
 typedef struct AstNode {
     enum {
         // leaf nodes
-        AST_NUMBER, AST_STRING, AST_BOOL,
+        AST_NUMBER, AST_INTEGER, AST_STRING, AST_BOOL,
         AST_NIL, AST_FN, AST_VAR,
 
         // multiple branches
         AST_BINOP, AST_UNOP, AST_IF,
         AST_ASSIGNMENT, AST_FNCALL, AST_BLOCK,
-        AST_CFN,
 
         AST_NOOP
     } type;
+    int line;
+
+    union {
+        // literals and variables
+        union {
+            char *ident_name;
+            double num_value;
+            int64_t int_value;
+            char *str_value;
+            int bool_value;
+            void *nil;
+        } value;
 
-    // binop and unop and assignment
-    struct AstNode *left;
-    struct AstNode *right;
-    Token op;
+        // variables, name aliases value.ident_name. the resolver sets
+        // the lexical address: the value is in slot 'slot' of the frame
+        // 'depth' parents up, or looked up by name in the global env
+        // when depth is VAR_GLOBAL. 'cell' is set when the slot may hold
+        // the cell of a variable closures captured
+        struct {
+            char *name;
+            int depth;
+            int slot;
+            int cell;
+        } var;
 
-    // if stmts
-    struct AstNode *condition;
-    struct AstNode *then_branch;
-    struct AstNode *else_branch;
+        // binop and unop, op is the operator token type. the typer sets
+        // the type it proved the operands have, see typer.h
+        struct {
+            struct AstNode *left;
+            struct AstNode *right;
+            int op;
+            int operands;
+        } binop;
 
-    // function definitions, body for print
-    struct AstNode **params;
-    int param_count;
-    struct AstNode *body;
+        struct {
+            struct AstNode *right;
+            int op;
+            int operand;
+        } unop;
 
-    // function calls
-    struct AstNode **args;
-    int arg_count;
-    // for anonymous fns
-    struct AstNode *lambda;
+        // assignment, left is the variable
+        struct {
+            struct AstNode *left;
+            struct AstNode *right;
+        } assign;
 
-    // block
-    struct AstNode **children;
-    int child_count;
+        // if expressions
+        struct {
+            struct AstNode *condition;
+            struct AstNode *then_branch;
+            struct AstNode *else_branch;
+        } if_expr;
 
-    // cfn
-    Builtin cfun_ptr;
+        // function definitions, name is set for printing. a lazily
+        // parsed fn has no body until its first call, see parser_parse_body.
+        // the resolver sets the variables from outside the fn that its
+        // body uses, which its closure copies into a frame of their own
+        struct {
+            char *name;
+            struct AstNode **params;
+            int param_count;
+            Capture *captures;
+            int capture_count;
+            struct AstNode *body;
+            struct LazyBody *lazy;
+        } fn;
 
-    // leaf nodes
-    Token token;
+        // function calls, name is NULL for anonymous fns
+        struct {
+            char *name;
+            struct AstNode **args;
+            int arg_count;
+            struct AstNode *lambda;
+        } fncall;
 
-    // literals
-    union {
-        char *ident_name;
-        double num_value;
-        char *str_value;
-        int bool_value;
-        void *nil;
-    } value;
+        // block, slot_count is the number of distinct names it binds
+        struct {
+            struct AstNode **children;
+            int child_count;
+            int slot_count;
+        } block;
+    };
 } AstNode;
 
+// depth of a variable that lives in the global env
+#define VAR_GLOBAL (-1)
+
+// node allocation counters
+typedef struct AstStats {
+    long nodes;
+    long bytes;
+} AstStats;
+
+// make the functions below allocate from 'arena', or with malloc when it
+// is NULL. returns the arena that was in use
+Arena *ast_set_arena(Arena *arena);
+// allocation counters since startup
+AstStats ast_stats(void);
+// bytes allocated for a node of 'type'
+size_t ast_node_size(int type);
+
+// copy 'length' bytes of a string to where the functions below allocate
+char *ast_strndup(const char *string, size_t length);
+
 // functions to create ast node
 AstNode *ast_init_num(double num);
+AstNode *ast_init_int(int64_t integer);
 AstNode *ast_init_str(char *string);
 AstNode *ast_init_bool(int truth);
 AstNode *ast_init_nil(void);
@@ -74,9 +150,15 @@ AstNode *ast_init_assign(AstNode *left, AstNode *right, Token op);
 AstNode *ast_init_if(AstNode *cond, AstNode *then, AstNode *alter);
 AstNode *ast_init_block(AstNode **children, int child_count);
 AstNode *ast_init_fn(AstNode **params, int param_count, AstNode *body);
+AstNode *ast_init_lazy_fn(
+    AstNode **params, int param_count, struct LazyBody *lazy, int line);
 AstNode *ast_init_fncall(
     char *fn_name, AstNode **args, int arg_count, AstNode *lambda);
-AstNode *ast_init_cfn(char *name, Builtin cfun_ptr);
 AstNode *ast_init_noop(void);
+// copy a list of 'count' nodes into a new array
+AstNode **ast_init_list(AstNode **nodes, int count);
+// deep copy the parts of a tree that live in arena 'from' into the
+// current arena, nodes outside of it are shared
+AstNode *ast_copy(AstNode *node, Arena *from);
 
 #endif
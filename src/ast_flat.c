@@ -0,0 +1,237 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ast_flat.h"
+#include "intern.h"
+#include "util.h"
+
+AstFlat *ast_flat_create(void) {
+    AstFlat *flat = calloc(1, sizeof(struct AstFlat));
+    return flat;
+}
+
+void ast_flat_destroy(AstFlat *self) {
+    free(self->kinds);
+    free(self->ops);
+    free(self->lines);
+    free(self->lhs);
+    free(self->rhs);
+    free(self->extra);
+    free(self->numbers);
+    free(self->integers);
+    free(self->text);
+    free(self);
+}
+
+size_t ast_flat_bytes(AstFlat *self) {
+    size_t node = sizeof(uint8_t) * 2 + sizeof(int) + sizeof(FlatRef) * 2;
+    return self->count * node + self->extra_count * sizeof(uint32_t) +
+           self->number_count * sizeof(double) +
+           self->integer_count * sizeof(int64_t) + self->text_count;
+}
+
+// append a node, the arrays grow together
+static FlatRef flat_push(
+    AstFlat *self, int kind, int line, int op, FlatRef lhs, FlatRef rhs) {
+    if (self->count == self->capacity) {
+        self->capacity = self->capacity * 2 + 256;
+        self->kinds = util_grow(self->kinds, self->capacity, sizeof(uint8_t));
+        self->ops = util_grow(self->ops, self->capacity, sizeof(uint8_t));
+        self->lines = util_grow(self->lines, self->capacity, sizeof(int));
+        self->lhs = util_grow(self->lhs, self->capacity, sizeof(FlatRef));
+        self->rhs = util_grow(self->rhs, self->capacity, sizeof(FlatRef));
+    }
+
+    FlatRef ref = self->count++;
+    self->kinds[ref] = kind;
+    self->ops[ref] = op;
+    self->lines[ref] = line;
+    self->lhs[ref] = lhs;
+    self->rhs[ref] = rhs;
+    return ref;
+}
+
+// reserve 'count' words of extra, returns their offset
+static uint32_t flat_extra(AstFlat *self, uint32_t count) {
+    if (self->extra_count + count > self->extra_capacity) {
+        self->extra_capacity = (self->extra_count + count) * 2 + 256;
+        self->extra = util_grow(
+            self->extra, self->extra_capacity, sizeof(uint32_t));
+    }
+
+    uint32_t offset = self->extra_count;
+    self->extra_count += count;
+    return offset;
+}
+
+// copy 'length' bytes into text, returns their offset
+static uint32_t flat_text(AstFlat *self, const char *string, int length) {
+    if (self->text_count + length > self->text_capacity) {
+        self->text_capacity = (self->text_count + length) * 2 + 4096;
+        self->text = util_grow(self->text, self->text_capacity, 1);
+    }
+
+    uint32_t offset = self->text_count;
+    memcpy(self->text + offset, string, length);
+    self->text_count += length;
+    return offset;
+}
+
+FlatRef ast_flat_num(AstFlat *self, double num) {
+    if (self->number_count == self->number_capacity) {
+        self->number_capacity = self->number_capacity * 2 + 256;
+        self->numbers = util_grow(
+            self->numbers, self->number_capacity, sizeof(double));
+    }
+
+    self->numbers[self->number_count] = num;
+    return flat_push(self, AST_NUMBER, 0, 0, self->number_count++, 0);
+}
+
+FlatRef ast_flat_int(AstFlat *self, int64_t integer) {
+    if (self->integer_count == self->integer_capacity) {
+        self->integer_capacity = self->integer_capacity * 2 + 256;
+        self->integers = util_grow(
+            self->integers, self->integer_capacity, sizeof(int64_t));
+    }
+
+    self->integers[self->integer_count] = integer;
+    return flat_push(self, AST_INTEGER, 0, 0, self->integer_count++, 0);
+}
+
+FlatRef ast_flat_str(AstFlat *self, const char *string, int length) {
+    uint32_t offset = flat_text(self, string, length);
+    return flat_push(self, AST_STRING, 0, 0, offset, length);
+}
+
+FlatRef ast_flat_bool(AstFlat *self, int truth) {
+    return flat_push(self, AST_BOOL, 0, 0, truth == 1, 0);
+}
+
+FlatRef ast_flat_nil(AstFlat *self) {
+    return flat_push(self, AST_NIL, 0, 0, 0, 0);
+}
+
+FlatRef ast_flat_var(AstFlat *self, char *name, Token token) {
+    int length = strlen(name);
+    uint32_t offset = flat_text(self, name, length);
+    return flat_push(self, AST_VAR, token.line, 0, offset, length);
+}
+
+FlatRef ast_flat_unop(AstFlat *self, FlatRef right, Token op) {
+    return flat_push(self, AST_UNOP, op.line, op.type, right, 0);
+}
+
+FlatRef ast_flat_binop(AstFlat *self, FlatRef left, FlatRef right, Token op) {
+    return flat_push(self, AST_BINOP, op.line, op.type, left, right);
+}
+
+FlatRef ast_flat_assign(AstFlat *self, FlatRef left, FlatRef right, Token op) {
+    return flat_push(self, AST_ASSIGNMENT, op.line, 0, left, right);
+}
+
+FlatRef ast_flat_if(AstFlat *self, FlatRef cond, FlatRef then, FlatRef alter) {
+    uint32_t branches = flat_extra(self, 2);
+    self->extra[branches] = then;
+    self->extra[branches + 1] = alter;
+
+    return flat_push(
+        self, AST_IF, self->lines[cond], 0, cond, branches);
+}
+
+FlatRef ast_flat_block(AstFlat *self, uint32_t children) {
+    return flat_push(self, AST_BLOCK, 0, 0, children, 0);
+}
+
+FlatRef ast_flat_fn(AstFlat *self, uint32_t params, FlatRef body) {
+    return flat_push(self, AST_FN, self->lines[body], 0, params, body);
+}
+
+FlatRef ast_flat_fncall(AstFlat *self, FlatRef callee, uint32_t args) {
+    return flat_push(self, AST_FNCALL, self->lines[callee], 0, callee, args);
+}
+
+FlatRef ast_flat_noop(AstFlat *self) {
+    return flat_push(self, AST_NOOP, 0, 0, 0, 0);
+}
+
+uint32_t ast_flat_list(AstFlat *self, int count) {
+    uint32_t list = flat_extra(self, count + 1);
+
+    self->extra[list] = count;
+    return list;
+}
+
+// rebuild the list at 'list' as an array of trees
+static AstNode **flat_to_list(AstFlat *self, uint32_t list, int *count) {
+    *count = self->extra[list];
+    AstNode **nodes = malloc(*count * sizeof(struct AstNode *));
+
+    for (int i = 0; i < *count; i++) {
+        nodes[i] = ast_flat_to_tree(self, self->extra[list + 1 + i]);
+    }
+
+    AstNode **copy = ast_init_list(nodes, *count);
+    free(nodes);
+    return copy;
+}
+
+AstNode *ast_flat_to_tree(AstFlat *self, FlatRef ref) {
+    // operator nodes are rebuilt through the same constructors as the
+    // parser uses, from a token holding the type and line
+    Token token = {self->ops[ref], 0, 0, self->lines[ref], NULL};
+    FlatRef lhs = self->lhs[ref];
+    FlatRef rhs = self->rhs[ref];
+    AstNode **list;
+    int count;
+
+    switch (self->kinds[ref]) {
+        case AST_NUMBER:
+            return ast_init_num(self->numbers[lhs]);
+        case AST_INTEGER:
+            return ast_init_int(self->integers[lhs]);
+        case AST_STRING:
+            return ast_init_str(ast_strndup(self->text + lhs, rhs));
+        case AST_BOOL:
+            return ast_init_bool(lhs);
+        case AST_NIL:
+            return ast_init_nil();
+        case AST_VAR:
+            return ast_init_var(intern_symbol(self->text + lhs, rhs), token);
+        case AST_UNOP:
+            return ast_init_unop(ast_flat_to_tree(self, lhs), token);
+        case AST_BINOP:
+            return ast_init_binop(
+                ast_flat_to_tree(self, lhs), ast_flat_to_tree(self, rhs),
+                token);
+        case AST_ASSIGNMENT:
+            return ast_init_assign(
+                ast_flat_to_tree(self, lhs), ast_flat_to_tree(self, rhs),
+                token);
+        case AST_IF:
+            return ast_init_if(
+                ast_flat_to_tree(self, lhs),
+                ast_flat_to_tree(self, self->extra[rhs]),
+                ast_flat_to_tree(self, self->extra[rhs + 1]));
+        case AST_BLOCK:
+            list = flat_to_list(self, lhs, &count);
+            return ast_init_block(list, count);
+        case AST_FN:
+            list = flat_to_list(self, lhs, &count);
+            return ast_init_fn(list, count, ast_flat_to_tree(self, rhs));
+        case AST_FNCALL: {
+            AstNode *callee = ast_flat_to_tree(self, lhs);
+            char *name = callee->type == AST_VAR
+                ? callee->value.ident_name : NULL;
+
+            list = flat_to_list(self, rhs, &count);
+            return ast_init_fncall(name, list, count, callee);
+        }
+        default:
+            return ast_init_noop();
+    }
+}
+
+AstNode **ast_flat_to_prog(AstFlat *self, int *child_count) {
+    return flat_to_list(self, self->root, child_count);
+}
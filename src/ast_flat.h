@@ -0,0 +1,88 @@
+#ifndef AST_FLAT_H
+#define AST_FLAT_H
+
+#include <stdint.h>
+#include "lexer.h"
+#include "ast.h"
+
+// index of a node in a flat ast
+typedef uint32_t FlatRef;
+
+// whole program ast stored as parallel arrays instead of linked nodes.
+// node i is kinds[i], lines[i], ops[i], lhs[i] and rhs[i], children are
+// referenced by index. what lhs and rhs hold depends on the kind:
+//
+//   AST_NUMBER      lhs = index into numbers
+//   AST_INTEGER     lhs = index into integers
+//   AST_STRING      lhs = offset into text, rhs = length
+//   AST_VAR         lhs = offset into text, rhs = length
+//   AST_BOOL        lhs = truth
+//   AST_UNOP        lhs = operand, ops = operator token type
+//   AST_BINOP       lhs, rhs = operands, ops = operator token type
+//   AST_ASSIGNMENT  lhs = variable, rhs = value
+//   AST_IF          lhs = condition, rhs = list [then, else]
+//   AST_FN          lhs = list of params, rhs = body
+//   AST_FNCALL      lhs = callee, rhs = list of args
+//   AST_BLOCK       lhs = list of children
+//
+// a list is an offset into extra, holding the count and then the items.
+// nothing in it is a pointer, so the arrays can be written out as is
+typedef struct AstFlat {
+    uint8_t *kinds;
+    uint8_t *ops;
+    int *lines;
+    FlatRef *lhs;
+    FlatRef *rhs;
+    uint32_t count;
+    uint32_t capacity;
+
+    uint32_t *extra;
+    uint32_t extra_count;
+    uint32_t extra_capacity;
+
+    double *numbers;
+    uint32_t number_count;
+    uint32_t number_capacity;
+
+    int64_t *integers;
+    uint32_t integer_count;
+    uint32_t integer_capacity;
+
+    char *text;
+    uint32_t text_count;
+    uint32_t text_capacity;
+
+    // list of top level forms
+    uint32_t root;
+} AstFlat;
+
+AstFlat *ast_flat_create(void);
+void ast_flat_destroy(AstFlat *self);
+// bytes held by the arrays
+size_t ast_flat_bytes(AstFlat *self);
+
+// functions to append a node, returning its index
+FlatRef ast_flat_num(AstFlat *self, double num);
+FlatRef ast_flat_int(AstFlat *self, int64_t integer);
+FlatRef ast_flat_str(AstFlat *self, const char *string, int length);
+FlatRef ast_flat_bool(AstFlat *self, int truth);
+FlatRef ast_flat_nil(AstFlat *self);
+FlatRef ast_flat_var(AstFlat *self, char *name, Token token);
+FlatRef ast_flat_unop(AstFlat *self, FlatRef right, Token op);
+FlatRef ast_flat_binop(AstFlat *self, FlatRef left, FlatRef right, Token op);
+FlatRef ast_flat_assign(AstFlat *self, FlatRef left, FlatRef right, Token op);
+FlatRef ast_flat_if(AstFlat *self, FlatRef cond, FlatRef then, FlatRef alter);
+FlatRef ast_flat_block(AstFlat *self, uint32_t children);
+FlatRef ast_flat_fn(AstFlat *self, uint32_t params, FlatRef body);
+FlatRef ast_flat_fncall(AstFlat *self, FlatRef callee, uint32_t args);
+FlatRef ast_flat_noop(AstFlat *self);
+// reserve a list of 'count' nodes in extra and return its offset, the
+// caller stores the items after the count
+uint32_t ast_flat_list(AstFlat *self, int count);
+
+// rebuild node 'ref' as a tree in the current ast arena
+AstNode *ast_flat_to_tree(AstFlat *self, FlatRef ref);
+// rebuild the top level forms as a tree
+AstNode **ast_flat_to_prog(AstFlat *self, int *child_count);
+
+#endif
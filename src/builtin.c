@@ -1,69 +1,72 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <inttypes.h>
 #include <math.h>
 #include "builtin.h"
 
-AstNode *builtin_puts(int argc, AstNode **args) {
+Value builtin_puts(int argc, Value *args) {
     for (int i = 0; i < argc; i++) {
-        switch (args[i]->type) {
-            case AST_NUMBER:
-                if (fmod(args[i]->value.num_value, 1) == 0) {
-                    printf("%d", (int)args[i]->value.num_value);
-                } else {
-                    printf("%lf", args[i]->value.num_value);
-                }
-                break;
-            case AST_STRING:
-                printf("%s", args[i]->value.str_value);
-                break;
-            case AST_BOOL:
-                if (args[i]->value.bool_value == 1) {
-                    printf("true");
-                } else {
-                    printf("false");
-                }
-                break;
-            case AST_NIL:
-                printf("nil");
-                break;
-            case AST_FN:
-                if (args[i]->value.ident_name == NULL) {
-                    printf("<lambda expression>");
-                } else {
-                    printf("<function %s>", args[i]->value.ident_name);
-                }
-                break;
-            default:
-                printf("");
-                return ast_init_noop();
+        Value value = args[i];
+
+        // an integral double below 2^53 prints as the int it is, -0 as 0.
+        // past that %.0f would print every digit of 1e300
+        if (value_is_int(value)) {
+            printf("%" PRId64, value_as_int(value));
+        } else if (VALUE_IS_NUM(value)) {
+            double num = value_as_num(value);
+            if (num == 0) {
+                printf("0");
+            } else if (fmod(num, 1) == 0 && fabs(num) < 9007199254740992.0) {
+                printf("%.0f", num);
+            } else if (fmod(num, 1) == 0) {
+                printf("%.17g", num);
+            } else {
+                printf("%lf", num);
+            }
+        } else if (VALUE_IS(value, OBJ_STRING)) {
+            printf("%s", VALUE_AS_STRING(value)->chars);
+        } else if (value == VALUE_TRUE) {
+            printf("true");
+        } else if (value == VALUE_FALSE) {
+            printf("false");
+        } else if (value == VALUE_NIL) {
+            printf("nil");
+        } else if (VALUE_IS(value, OBJ_CLOSURE)) {
+            if (VALUE_AS_CLOSURE(value)->name == NULL) {
+                printf("<lambda expression>");
+            } else {
+                printf("<function %s>", VALUE_AS_CLOSURE(value)->name);
+            }
+        } else {
+            return VALUE_NOOP;
         }
     }
     printf("\n");
-    return ast_init_noop();
+    return VALUE_NOOP;
 }
 
-AstNode *builtin_gets(int argc, AstNode **args) {
+Value builtin_gets(int argc, Value *args) {
     if (argc > 1) {
         printf("gets expect at most 1 argument, got %d\n", argc);
         exit(1);
     } else if (argc == 1) {
-        if (args[0]->type != AST_STRING) {
+        if (!VALUE_IS(args[0], OBJ_STRING)) {
             puts("gets only takes string as an argument");
             exit(1);
         }
-        printf("%s", args[0]->value.str_value);
+        printf("%s", VALUE_AS_STRING(args[0])->chars);
     }
 
-    char *result = NULL;
+    char *line = NULL;
     size_t size = 0;
-    ssize_t len = getline(&result, &size, stdin);
+    ssize_t len = getline(&line, &size, stdin);
 
     if (len == -1) {
         puts("error reading input");
         exit(1);
     }
 
-    result[len - 1] = '\0';
-    return ast_init_str(result);
+    Value result = value_init_str(line, len - 1);
+    free(line);
+    return result;
 }
-
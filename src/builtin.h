@@ -1,11 +1,11 @@
 #ifndef BUILTIN_H
 #define BUILTIN_H
 
-#include "ast.h"
+#include "value.h"
 
 // puts (print function)
-AstNode *builtin_puts(int argc, AstNode **args);
+Value builtin_puts(int argc, Value *args);
 // gets (scanf/fgets)
-AstNode *builtin_gets(int argc, AstNode **args);
+Value builtin_gets(int argc, Value *args);
 
 #endif
@@ -0,0 +1,400 @@
+#include <stdlib.h>
+#include "compiler.h"
+#include "resolver.h"
+#include "gc.h"
+#include "typer.h"
+
+static const struct {
+    const char *name;
+    int operands;
+} opcodes[] = {
+#define COMPILER_OPCODE_ENTRY(name, operands) {#name, operands},
+    COMPILER_OPCODES(COMPILER_OPCODE_ENTRY)
+#undef COMPILER_OPCODE_ENTRY
+};
+
+int compiler_fuse = 1;
+
+// compiler state for the code being compiled, 'depth' is the number of
+// values on the stack at the current instruction. 'blocks' is the number
+// of blocks a form in tail position is the last form of, a call there
+// leaves them before it's made
+typedef struct Compiler {
+    Code *code;
+    int depth;
+    int blocks;
+} Compiler;
+
+static void compiler_compile_node(Compiler *self, AstNode *node);
+static void compiler_compile_tail(Compiler *self, AstNode *node);
+
+const char *compiler_opcode_name(int opcode) {
+    return opcodes[opcode].name;
+}
+
+int compiler_opcode_operands(int opcode) {
+    return opcodes[opcode].operands;
+}
+
+static Code *compiler_init_code(AstNode *fn) {
+    Code *code = calloc(1, sizeof(struct Code));
+    code->fn = fn;
+    return code;
+}
+
+Code *compiler_init_fn(AstNode *fn) {
+    return compiler_init_code(fn);
+}
+
+// append a word to the code
+static void compiler_write(Compiler *self, int word) {
+    Code *code = self->code;
+
+    if (code->count == code->capacity) {
+        code->capacity = code->capacity * 2 + 64;
+        code->ops = realloc(code->ops, code->capacity * sizeof(int));
+    }
+    code->ops[code->count++] = word;
+}
+
+// append an instruction that leaves 'effect' more values on the stack
+static void compiler_emit(Compiler *self, int opcode, int effect) {
+    compiler_write(self, opcode);
+
+    self->depth += effect;
+    if (self->depth > self->code->max_stack) {
+        self->code->max_stack = self->depth;
+    }
+}
+
+static int compiler_constant(Compiler *self, Value value) {
+    Code *code = self->code;
+
+    if (code->constant_count == code->constant_capacity) {
+        code->constant_capacity = code->constant_capacity * 2 + 8;
+        code->constants = realloc(code->constants,
+            code->constant_capacity * sizeof(Value));
+    }
+    code->constants[code->constant_count] = value;
+    return code->constant_count++;
+}
+
+static int compiler_node(Compiler *self, AstNode *node) {
+    Code *code = self->code;
+
+    if (code->node_count == code->node_capacity) {
+        code->node_capacity = code->node_capacity * 2 + 8;
+        code->nodes = realloc(code->nodes,
+            code->node_capacity * sizeof(struct AstNode *));
+    }
+    code->nodes[code->node_count] = node;
+    return code->node_count++;
+}
+
+static void compiler_emit_const(Compiler *self, Value value) {
+    compiler_emit(self, OP_CONST, 1);
+    compiler_write(self, compiler_constant(self, value));
+}
+
+// emit a jump with its target left to compiler_patch, returns where the
+// target goes
+static int compiler_emit_jump(Compiler *self, int opcode, int effect) {
+    compiler_emit(self, opcode, effect);
+    compiler_write(self, -1);
+    return self->code->count - 1;
+}
+
+// make a jump go to the next instruction
+static void compiler_patch(Compiler *self, int target) {
+    self->code->ops[target] = self->code->count;
+}
+
+// load a variable from its address, 'node' is reported if it's unbound
+static void compiler_compile_load(
+    Compiler *self, AstNode *var, AstNode *node) {
+    int index = compiler_node(self, node);
+
+    if (var->var.depth == VAR_GLOBAL) {
+        compiler_emit(self, OP_LOAD_GLOBAL, 1);
+    } else if (var->var.cell) {
+        compiler_emit(self, OP_LOAD_CELL, 1);
+        compiler_write(self, var->var.depth);
+        compiler_write(self, var->var.slot);
+    } else if (var->var.depth == 0) {
+        compiler_emit(self, OP_LOAD_LOCAL, 1);
+        compiler_write(self, var->var.slot);
+    } else {
+        compiler_emit(self, OP_LOAD_OUTER, 1);
+        compiler_write(self, var->var.depth);
+        compiler_write(self, var->var.slot);
+    }
+    compiler_write(self, index);
+}
+
+// value of an assignment is a noop
+static void compiler_compile_assignment(Compiler *self, AstNode *node) {
+    AstNode *left = node->assign.left;
+
+    compiler_compile_node(self, node->assign.right);
+    if (left->var.depth == VAR_GLOBAL) {
+        compiler_emit(self, OP_STORE_GLOBAL, -1);
+        compiler_write(self, compiler_node(self, left));
+    } else {
+        compiler_emit(self, left->var.cell ? OP_STORE_CELL : OP_STORE_LOCAL,
+                      -1);
+        compiler_write(self, left->var.slot);
+    }
+    compiler_emit_const(self, VALUE_NOOP);
+}
+
+// the branches of an if in tail position are in tail position
+static void compiler_compile_if(Compiler *self, AstNode *node, int tail) {
+    void (*compile)(Compiler *, AstNode *) =
+        tail ? compiler_compile_tail : compiler_compile_node;
+
+    compiler_compile_node(self, node->if_expr.condition);
+    int to_else = compiler_emit_jump(self, OP_JUMP_IF_FALSE, -1);
+
+    compile(self, node->if_expr.then_branch);
+    int to_end = compiler_emit_jump(self, OP_JUMP, 0);
+
+    // only one of the branches leaves its value
+    self->depth--;
+    compiler_patch(self, to_else);
+    compile(self, node->if_expr.else_branch);
+    compiler_patch(self, to_end);
+}
+
+static void compiler_compile_binop(Compiler *self, AstNode *node) {
+    int opcode;
+
+    switch (node->binop.op) {
+        case TOKEN_PLUS:   opcode = OP_ADD; break;
+        case TOKEN_MINUS:  opcode = OP_SUB; break;
+        case TOKEN_MUL:    opcode = OP_MUL; break;
+        case TOKEN_DIV:    opcode = OP_DIV; break;
+        case TOKEN_MOD:    opcode = OP_MOD; break;
+        case TOKEN_LT:     opcode = OP_LT; break;
+        case TOKEN_GT:     opcode = OP_GT; break;
+        case TOKEN_LTE:    opcode = OP_LTE; break;
+        case TOKEN_GTE:    opcode = OP_GTE; break;
+        case TOKEN_EQUAL:  opcode = OP_EQUAL; break;
+        case TOKEN_NEQUAL: opcode = OP_NEQUAL; break;
+        case TOKEN_AND:    opcode = OP_AND; break;
+        default:           opcode = OP_OR; break;
+    }
+
+    // operands the typer proved numbers, or bools for and and or
+    if (node->binop.operands == TYPE_NUM || node->binop.operands == TYPE_BOOL) {
+        opcode += OP_ADD_NUM - OP_ADD;
+    }
+
+    compiler_compile_node(self, node->binop.left);
+    compiler_compile_node(self, node->binop.right);
+    compiler_emit(self, opcode, -1);
+}
+
+// the frame of a block is entered and left around its forms, every form
+// but the last is popped. the last form of a block in tail position is
+// in tail position
+static void compiler_compile_block(Compiler *self, AstNode *node, int tail) {
+    int last = node->block.child_count - 1;
+
+    compiler_emit(self, OP_ENTER, 0);
+    compiler_write(self, node->block.slot_count);
+
+    if (last < 0) compiler_emit_const(self, VALUE_NOOP);
+    for (int i = 0; i < last; i++) {
+        compiler_compile_node(self, node->block.children[i]);
+        compiler_emit(self, OP_POP, -1);
+    }
+    if (last >= 0 && tail) {
+        self->blocks++;
+        compiler_compile_tail(self, node->block.children[last]);
+        self->blocks--;
+    } else if (last >= 0) {
+        compiler_compile_node(self, node->block.children[last]);
+    }
+
+    compiler_emit(self, OP_LEAVE, 0);
+}
+
+static void compiler_compile_closure(Compiler *self, AstNode *node) {
+    Code *code = self->code;
+
+    if (code->fn_count == code->fn_capacity) {
+        code->fn_capacity = code->fn_capacity * 2 + 4;
+        code->fns = realloc(
+            code->fns, code->fn_capacity * sizeof(struct Code *));
+    }
+    code->fns[code->fn_count] = compiler_init_code(node);
+
+    compiler_emit(self, OP_CLOSURE, 1);
+    compiler_write(self, code->fn_count++);
+}
+
+// a named callee reports the call when it's unbound. a call in tail
+// position leaves the blocks it's in and replaces the running fn
+static void compiler_compile_fncall(Compiler *self, AstNode *node, int tail) {
+    AstNode *lambda = node->fncall.lambda;
+
+    if (node->fncall.name != NULL) {
+        compiler_compile_load(self, lambda, node);
+    } else {
+        compiler_compile_node(self, lambda);
+    }
+
+    for (int i = 0; i < node->fncall.arg_count; i++) {
+        compiler_compile_node(self, node->fncall.args[i]);
+    }
+
+    for (int i = 0; tail && i < self->blocks; i++) {
+        compiler_emit(self, OP_LEAVE, 0);
+    }
+
+    compiler_emit(self, tail ? OP_TAIL_CALL : OP_CALL,
+                  -node->fncall.arg_count);
+    compiler_write(self, node->fncall.arg_count);
+    compiler_write(self, compiler_node(self, node));
+}
+
+static void compiler_compile_node(Compiler *self, AstNode *node) {
+    switch (node->type) {
+        case AST_VAR:
+            compiler_compile_load(self, node, node);
+            break;
+        case AST_ASSIGNMENT:
+            compiler_compile_assignment(self, node);
+            break;
+        case AST_IF:
+            compiler_compile_if(self, node, 0);
+            break;
+        case AST_BINOP:
+            compiler_compile_binop(self, node);
+            break;
+        case AST_UNOP:
+            compiler_compile_node(self, node->unop.right);
+            if (node->unop.op == TOKEN_BANG) compiler_emit(self, OP_NOT, 0);
+            if (node->unop.op == TOKEN_MINUS) {
+                compiler_emit(self, node->unop.operand == TYPE_NUM
+                              ? OP_NEG_NUM : OP_NEG, 0);
+            }
+            break;
+        case AST_BLOCK:
+            compiler_compile_block(self, node, 0);
+            break;
+        case AST_FN:
+            compiler_compile_closure(self, node);
+            break;
+        case AST_FNCALL:
+            compiler_compile_fncall(self, node, 0);
+            break;
+        case AST_NUMBER:
+        case AST_INTEGER:
+        case AST_STRING:
+        case AST_BOOL:
+        case AST_NIL:
+            // constants live as long as the code, which is never freed
+            compiler_emit_const(self, gc_pin(value_of_literal(node)));
+            break;
+        default:
+            compiler_emit_const(self, VALUE_NOOP);
+    }
+}
+
+// compile a form in tail position, the value of the fn it's in
+static void compiler_compile_tail(Compiler *self, AstNode *node) {
+    switch (node->type) {
+        case AST_IF:
+            compiler_compile_if(self, node, 1);
+            break;
+        case AST_BLOCK:
+            compiler_compile_block(self, node, 1);
+            break;
+        case AST_FNCALL:
+            compiler_compile_fncall(self, node, 1);
+            break;
+        default:
+            compiler_compile_node(self, node);
+    }
+}
+
+static int compiler_is_compare(int opcode) {
+    return (opcode >= OP_LT && opcode <= OP_NEQUAL) ||
+           (opcode >= OP_LT_NUM && opcode <= OP_NEQUAL_NUM);
+}
+
+static int compiler_is_arith(int opcode) {
+    return (opcode >= OP_ADD && opcode <= OP_MOD) ||
+           (opcode >= OP_ADD_NUM && opcode <= OP_MOD_NUM);
+}
+
+// superinstruction for the sequence at 'ops', or -1. 'targets' marks the
+// words jumps go to, no jump may land inside the sequence
+static int compiler_match(int *ops, int length, char *targets) {
+    if (ops[0] != OP_LOAD_LOCAL || length < 7 || targets[3]) return -1;
+
+    if (ops[3] == OP_LOAD_LOCAL) {
+        if (compiler_is_arith(ops[6]) && !targets[6]) {
+            return OP_ARITH_LOCAL_LOCAL;
+        }
+        return -1;
+    }
+    if (ops[3] != OP_CONST || targets[5]) return -1;
+
+    if (compiler_is_compare(ops[5]) && length >= 8 &&
+        ops[6] == OP_JUMP_IF_FALSE && !targets[6]) {
+        return OP_TEST_LOCAL_CONST;
+    }
+    if (!compiler_is_arith(ops[5])) return -1;
+    if (length >= 9 && ops[6] == OP_CALL && ops[7] == 1 && !targets[6]) {
+        return OP_CALL_ARITH_LOCAL_CONST;
+    }
+    return OP_ARITH_LOCAL_CONST;
+}
+
+// replace common sequences of instructions by superinstructions
+static void compiler_fuse_code(Code *code) {
+    int *ops = code->ops;
+    char *targets = calloc(code->count + 1, 1);
+
+    for (int i = 0; i < code->count; i += 1 + opcodes[ops[i]].operands) {
+        if (ops[i] == OP_JUMP || ops[i] == OP_JUMP_IF_FALSE) {
+            targets[ops[i + 1]] = 1;
+        }
+    }
+
+    for (int i = 0; i < code->count; i += 1 + opcodes[ops[i]].operands) {
+        int fused = compiler_match(ops + i, code->count - i, targets + i);
+        if (fused >= 0) ops[i] = fused;
+    }
+
+    free(targets);
+}
+
+Code *compiler_compile_prog(AstNode **root, int child_count) {
+    Compiler compiler = {compiler_init_code(NULL), 0, 0};
+
+    if (child_count == 0) compiler_emit_const(&compiler, VALUE_NOOP);
+    for (int i = 0; i < child_count; i++) {
+        if (i > 0) compiler_emit(&compiler, OP_POP, -1);
+        compiler_compile_node(&compiler, root[i]);
+    }
+    compiler_emit(&compiler, OP_RETURN, -1);
+
+    if (compiler_fuse) compiler_fuse_code(compiler.code);
+    compiler.code->compiled = 1;
+    return compiler.code;
+}
+
+void compiler_compile_fn(Code *code) {
+    Compiler compiler = {code, 0, 0};
+
+    if (code->fn->fn.lazy != NULL) resolver_parse_body(code->fn);
+
+    compiler_compile_tail(&compiler, code->fn->fn.body);
+    compiler_emit(&compiler, OP_RETURN, -1);
+
+    if (compiler_fuse) compiler_fuse_code(code);
+    code->compiled = 1;
+}
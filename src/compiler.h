@@ -0,0 +1,102 @@
+#ifndef COMPILER_H
+#define COMPILER_H
+
+#include <stdint.h>
+#include "value.h"
+
+// instructions of the vm and the number of operands each takes. operands
+// follow their instruction in the code. 'constant' operands index the
+// constants, 'node' operands the nodes, which name the variable or call
+// an error is reported for
+#define COMPILER_OPCODES(X) \
+    X(CONST, 1)        /* constant                  -> value */ \
+    X(POP, 0)          /* value                     -> */ \
+    X(LOAD_LOCAL, 2)   /* slot, node                -> value */ \
+    X(LOAD_OUTER, 3)   /* depth, slot, node         -> value */ \
+    X(LOAD_GLOBAL, 1)  /* node                      -> value */ \
+    X(LOAD_CELL, 3)    /* depth, slot, node, from its cell if it's in one */ \
+    X(STORE_LOCAL, 1)  /* slot              value   -> */ \
+    X(STORE_CELL, 1)   /* slot, into its cell if it's in one */ \
+    X(STORE_GLOBAL, 1) /* node              value   -> */ \
+    X(ADD, 0) X(SUB, 0) X(MUL, 0) X(DIV, 0) X(MOD, 0) \
+    X(LT, 0) X(GT, 0) X(LTE, 0) X(GTE, 0) X(EQUAL, 0) X(NEQUAL, 0) \
+    X(AND, 0) X(OR, 0) /* left, right               -> value */ \
+    X(NEG, 0) X(NOT, 0) /* value                    -> value */ \
+    /* the same, in the same order, on operands the typer proved numbers */ \
+    /* or bools, see typer.h. they don't check what the operands are */ \
+    X(ADD_NUM, 0) X(SUB_NUM, 0) X(MUL_NUM, 0) X(DIV_NUM, 0) X(MOD_NUM, 0) \
+    X(LT_NUM, 0) X(GT_NUM, 0) X(LTE_NUM, 0) X(GTE_NUM, 0) \
+    X(EQUAL_NUM, 0) X(NEQUAL_NUM, 0) X(AND_BOOL, 0) X(OR_BOOL, 0) \
+    X(NEG_NUM, 0) \
+    X(JUMP, 1)         /* target */ \
+    X(JUMP_IF_FALSE, 1) /* target           value   -> */ \
+    X(CLOSURE, 1)      /* fn                        -> closure */ \
+    X(CALL, 2)         /* arg count, node   callee, args -> value */ \
+    X(TAIL_CALL, 2)    /* the same, in place of the running fn */ \
+    X(ENTER, 1)        /* slot count, pushes a block frame */ \
+    X(LEAVE, 0)        /* pops it */ \
+    X(RETURN, 0)       /* value, back to the caller */ \
+    COMPILER_SUPERINSTRUCTIONS(X)
+
+// superinstructions replace the opcode of the first instruction of a
+// common sequence, the words of the rest stay where they were and are
+// read as operands. jumps keep their targets that way
+#define COMPILER_SUPERINSTRUCTIONS(X) \
+    /* LOAD_LOCAL, CONST, one of LT to NEQUAL or their _NUM ones, */ \
+    /* JUMP_IF_FALSE: if n <= 1 */ \
+    X(TEST_LOCAL_CONST, 7) \
+    /* LOAD_LOCAL, CONST, one of ADD to MOD or their _NUM ones: n - 1 */ \
+    X(ARITH_LOCAL_CONST, 5) \
+    /* the same, then CALL with it as the only arg: fac(n - 1) */ \
+    X(CALL_ARITH_LOCAL_CONST, 8) \
+    /* LOAD_LOCAL, LOAD_LOCAL, one of ADD to MOD: n * n */ \
+    X(ARITH_LOCAL_LOCAL, 6)
+
+#define COMPILER_OPCODE_ENUM(name, operands) OP_##name,
+
+enum {
+    COMPILER_OPCODES(COMPILER_OPCODE_ENUM)
+    OP_COUNT
+};
+
+// compiled code of a fn, or of the top level forms of a program. the
+// fns created in it are compiled on their first call
+typedef struct Code {
+    int *ops;
+    int count;
+    int capacity;
+    // values of literals
+    Value *constants;
+    int constant_count;
+    int constant_capacity;
+    // nodes that loads and calls report errors for
+    AstNode **nodes;
+    int node_count;
+    int node_capacity;
+    // code of the fns created here, 'fn' is their fn node
+    struct Code **fns;
+    int fn_count;
+    int fn_capacity;
+    AstNode *fn;
+    int compiled;
+    // most values the code has on the stack at once
+    int max_stack;
+    // ops as the vm dispatches them, filled in on the first run
+    intptr_t *words;
+} Code;
+
+// when cleared, no superinstructions are formed
+extern int compiler_fuse;
+
+// spelling of an opcode and its number of operands
+const char *compiler_opcode_name(int opcode);
+int compiler_opcode_operands(int opcode);
+
+// compile the top level forms of a program, leaving the last form's value
+Code *compiler_compile_prog(AstNode **root, int child_count);
+// code of a fn node, compiled by compiler_compile_fn
+Code *compiler_init_fn(AstNode *fn);
+// compile the body of a fn, parsing it first if it's lazily parsed
+void compiler_compile_fn(Code *code);
+
+#endif
@@ -1,23 +1,20 @@
 #include <stdio.h>
+#include <inttypes.h>
 #include "debug.h"
+#include "intern.h"
 
 // token to string function
-void print_tokens(Token *token) {
+void print_tokens(Lexer *lexer, Token *token) {
     char *type;
     switch (token->type) {
         case TOKEN_NUMBER: type = "NUMBER"; break;
+        case TOKEN_INTEGER: type = "INTEGER"; break;
         case TOKEN_STRING: type = "STRING"; break;
         case TOKEN_IDENT:  type = "IDENT"; break;
-        case TOKEN_TRUE:   type = "TRUE"; break;
-        case TOKEN_FALSE:  type = "FALSE"; break;
-        case TOKEN_NIL:    type = "NIL"; break;
-        case TOKEN_LET:    type = "LET"; break;
-        case TOKEN_IF:     type = "IF"; break;
-        case TOKEN_THEN:   type = "THEN"; break;
-        case TOKEN_ELSE:   type = "ELSE"; break;
-        case TOKEN_FN:     type = "FN"; break;
-        case TOKEN_AND:    type = "AND"; break;
-        case TOKEN_OR:     type = "OR"; break;
+#define DEBUG_KEYWORD_CASE(name, spelling) \
+        case TOKEN_##name: type = #name; break;
+        LEXER_KEYWORDS(DEBUG_KEYWORD_CASE)
+#undef DEBUG_KEYWORD_CASE
         case TOKEN_RPAREN: type = "RPAREN"; break;
         case TOKEN_LPAREN: type = "LPAREN"; break;
         case TOKEN_LT:     type = "LT"; break;
@@ -36,13 +33,12 @@ void print_tokens(Token *token) {
         case TOKEN_MUL:    type = "MUL"; break;
         case TOKEN_DIV:    type = "DIV"; break;
         case TOKEN_MOD:    type = "MOD"; break;
-        case TOKEN_DO:     type = "DO"; break;
-        case TOKEN_DONE:   type = "DONE"; break;
         case TOKEN_EOF:    type = "EOF"; break;
     }
 
-    printf("TOKEN[type: %s, value: \"%s\", line: %d]\n",
-            type, token->value, token->line);
+    printf("TOKEN[type: %s, value: \"%.*s\", line: %d]\n",
+            type, token->length, lexer_token_text(lexer, token),
+            token->line);
 }
 
 // hacky ast to string function
@@ -52,6 +48,10 @@ void print_ast(AstNode *node) {
             printf("NUMBER ");
             printf("%f\n", node->value.num_value);
             break;
+        case AST_INTEGER:
+            printf("INTEGER ");
+            printf("%" PRId64 "\n", node->value.int_value);
+            break;
         case AST_STRING:
             printf("STRING ");
             printf("%s\n", node->value.str_value);
@@ -62,50 +62,50 @@ void print_ast(AstNode *node) {
             break;
         case AST_UNOP:
             printf("UNOP\n");
-            printf("operator %s\n", node->op.value);
+            printf("operator %s\n", lexer_token_lexeme(node->unop.op));
             printf("right ");
-            print_ast(node->right);
+            print_ast(node->unop.right);
             break;
         case AST_BINOP:
             printf("BINOP\n");
             printf("left ");
-            print_ast(node->left);
-            printf("operator %s\n", node->op.value);
+            print_ast(node->binop.left);
+            printf("operator %s\n", lexer_token_lexeme(node->binop.op));
             printf("right ");
-            print_ast(node->right);
+            print_ast(node->binop.right);
             break;
         case AST_IF:
             printf("IF\n");
             printf("cond ");
-            print_ast(node->condition);
+            print_ast(node->if_expr.condition);
             printf("then ");
-            print_ast(node->then_branch);
+            print_ast(node->if_expr.then_branch);
             printf("else ");
-            print_ast(node->else_branch);
+            print_ast(node->if_expr.else_branch);
             break;
         case AST_FN:
             printf("FN\n");
             printf("params ");
-            for (int i = 0; i < node->param_count; i++) {
-                print_ast(node->params[i]);
+            for (int i = 0; i < node->fn.param_count; i++) {
+                print_ast(node->fn.params[i]);
             }
             printf("body ");
-            print_ast(node->body);
+            print_ast(node->fn.body);
             break;
         case AST_ASSIGNMENT:
             printf("ASS\n");
             printf("varname ");
-            print_ast(node->left);
+            print_ast(node->assign.left);
             printf("value ");
-            print_ast(node->right);
+            print_ast(node->assign.right);
             break;
         case AST_FNCALL:
             printf("FNCALL\n");
-            printf("fn name %s", node->value.ident_name);
+            printf("fn name %s", node->fncall.name);
             puts("");
             printf("args ");
-            for (int i = 0; i < node->arg_count; i++) {
-                print_ast(node->args[i]);
+            for (int i = 0; i < node->fncall.arg_count; i++) {
+                print_ast(node->fncall.args[i]);
             }
             break;
         case AST_NIL:
@@ -121,8 +121,8 @@ void print_ast(AstNode *node) {
             break;
         case AST_BLOCK:
             puts("DO");
-            for (int i = 0; i < node->child_count; i++) {
-                print_ast(node->children[i]);
+            for (int i = 0; i < node->block.child_count; i++) {
+                print_ast(node->block.children[i]);
             }
             puts("DONE");
     }
@@ -133,7 +133,7 @@ void debug_print_tokens(Lexer *lexer) {
     Token token;
     do {
         token = lexer_get_next_token(lexer);
-        print_tokens(&token);
+        print_tokens(lexer, &token);
     } while (token.type != TOKEN_EOF);
 }
 
@@ -145,3 +145,24 @@ void debug_print_ast(AstNode **root, int child_count) {
     }
 }
 
+// run print ast on a flat ast, rebuilt as a tree in a scratch arena
+void debug_print_flat(AstFlat *flat) {
+    Arena *arena = arena_create();
+    Arena *previous = ast_set_arena(arena);
+    int child_count;
+
+    AstNode **root = ast_flat_to_prog(flat, &child_count);
+    debug_print_ast(root, child_count);
+
+    ast_set_arena(previous);
+    arena_destroy(arena);
+}
+
+// print symbol table statistics
+void debug_print_symbols(void) {
+    InternStats stats = intern_stats();
+
+    printf("symbols: %ld unique, %ld lookups\n", stats.symbols, stats.lookups);
+    printf("symbol bytes: %ld stored, %ld saved\n",
+           stats.bytes, stats.bytes_saved);
+}
@@ -3,11 +3,14 @@
 
 #include "lexer.h"
 #include "ast.h"
+#include "ast_flat.h"
 
 // for debugging purposes
-void print_tokens(Token *token);
+void print_tokens(Lexer *lexer, Token *token);
 void print_ast(AstNode *node);
 void debug_print_tokens(Lexer *lexer);
 void debug_print_ast(AstNode **root, int child_count);
+void debug_print_flat(AstFlat *flat);
+void debug_print_symbols(void);
 
 #endif
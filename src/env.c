@@ -1,73 +1,279 @@
 #include <stdlib.h>
-#include <string.h>
 #include "env.h"
 #include "builtin.h"
+#include "intern.h"
+#include "gc.h"
 
 Env *create_env(Env *parent) {
-    Env *env = malloc(sizeof(struct Env));
+    return create_frame(parent, 0);
+}
+
+Env *create_frame(Env *parent, int slot_count) {
+    // the parent may be held by nothing but the caller, like the env of
+    // a closure that is called right away
+    if (parent != NULL) gc_push(VALUE_OBJ(parent));
+    Env *env = (Env *)gc_alloc(
+        OBJ_ENV, sizeof(struct Env) + slot_count * sizeof(Value));
+    if (parent != NULL) gc_pop(1);
 
     env->records = NULL;
+    env->record_count = 0;
+    env->record_capacity = 0;
     env->parent = parent;
-    env->records = NULL;
+    env->slot_count = slot_count;
+    for (int i = 0; i < slot_count; i++) env->slots[i] = VALUE_UNDEFINED;
 
     return env;
 }
 
-void env_insert_var(Env **env, char *varname, AstNode *value) {
-    struct Records *record = malloc(sizeof(struct Records));
+Value env_capture(Env *env, AstNode *fn) {
+    int count = fn->fn.capture_count;
+    Env *frame = count > 0 ? create_frame(NULL, count) : NULL;
 
-    record->varname = varname;
-    record->value = value;
-    record->next = (*env)->records;
+    // the frame is only held here while cells are made
+    if (frame != NULL) gc_push(VALUE_OBJ(frame));
+    for (int i = 0; i < count; i++) {
+        Capture *capture = &fn->fn.captures[i];
+        Env *source = env;
+        for (int j = 0; j < capture->depth; j++) source = source->parent;
 
-    (*env)->records = record;
+        Value value = source->slots[capture->slot];
+        if (capture->cell && !VALUE_IS(value, OBJ_CELL)) {
+            value = value_init_cell(value);
+            source->slots[capture->slot] = value;
+        }
+        frame->slots[i] = value;
+    }
+
+    Value closure = value_init_closure(fn, frame);
+    if (frame != NULL) gc_pop(1);
+    return closure;
 }
 
-int env_check_var(Env *env, char *varname) {
-    struct Env dup = *env;
-    struct Env *env_ptr = &dup;
+// the frame stack is a list of chunks of this size, frames are bumped out
+// of the top chunk. chunks are kept once reserved, so a frame never moves
+#define ENV_STACK_CHUNK (256 * 1024)
+
+struct StackChunk {
+    struct StackChunk *prev;
+    struct StackChunk *next;
+    size_t size;
+    size_t used;
+    _Alignas(16) char data[];
+};
+
+static struct StackChunk *stack_top = NULL;
+
+// make the next chunk the top, reserving it if there's none big enough
+static void env_stack_grow(size_t size) {
+    struct StackChunk *next = stack_top ? stack_top->next : NULL;
+
+    if (next == NULL || next->size < size) {
+        size_t chunk_size = size > ENV_STACK_CHUNK ? size : ENV_STACK_CHUNK;
+        struct StackChunk *chunk = malloc(
+            sizeof(struct StackChunk) + chunk_size);
+
+        chunk->prev = stack_top;
+        chunk->next = next;
+        chunk->size = chunk_size;
+        if (next != NULL) next->prev = chunk;
+        if (stack_top != NULL) stack_top->next = chunk;
+
+        next = chunk;
+    }
+
+    next->used = 0;
+    stack_top = next;
+}
+
+Env *env_push_frame(Env *parent, int slot_count) {
+    size_t size = sizeof(struct Env) + slot_count * sizeof(Value);
+
+    if (stack_top == NULL || stack_top->size - stack_top->used < size) {
+        env_stack_grow(size);
+    }
+
+    Env *env = (Env *)(stack_top->data + stack_top->used);
+    stack_top->used += size;
+
+    env->object.type = OBJ_ENV;
+    env->object.marked = 0;
+    env->object.next = NULL;
+    env->records = NULL;
+    env->record_count = 0;
+    env->record_capacity = 0;
+    env->parent = parent;
+    env->slot_count = slot_count;
+    for (int i = 0; i < slot_count; i++) env->slots[i] = VALUE_UNDEFINED;
+
+    return env;
+}
+
+void env_pop_frame(Env *frame) {
+    stack_top->used = (char *)frame - stack_top->data;
+    if (stack_top->used == 0 && stack_top->prev != NULL) {
+        stack_top = stack_top->prev;
+    }
+}
+
+void env_visit_frames(void (*visit)(Env *frame)) {
+    if (stack_top == NULL) return;
 
-    while (env_ptr != NULL) {
-        while (env_ptr->records != NULL) {
-            if (strcmp(env_ptr->records->varname, varname) == 0) return 1;
-            env_ptr->records = env_ptr->records->next;
+    struct StackChunk *chunk = stack_top;
+    while (chunk->prev != NULL) chunk = chunk->prev;
+
+    for (; chunk != stack_top->next; chunk = chunk->next) {
+        for (size_t used = 0; used < chunk->used;) {
+            Env *frame = (Env *)(chunk->data + used);
+            visit(frame);
+            used += sizeof(struct Env) + frame->slot_count * sizeof(Value);
         }
+    }
+}
+
+// record binding 'varname' in a single env, NULL if it doesn't bind it
+static struct Record *env_find_record(Env *env, char *varname) {
+    if (env->record_capacity <= ENV_INLINE) {
+        for (int i = 0; i < env->record_count; i++) {
+            if (env->records[i].varname == varname) return &env->records[i];
+        }
+        return NULL;
+    }
 
-        env_ptr = env_ptr->parent;
+    unsigned mask = env->record_capacity - 1;
+    unsigned slot = INTERN_SYMBOL_HASH(varname) & mask;
+
+    while (env->records[slot].varname != NULL) {
+        if (env->records[slot].varname == varname) return &env->records[slot];
+        slot = (slot + 1) & mask;
+    }
+    return NULL;
+}
+
+// put a record in the empty slot of the hash table it probes to
+static void env_place_record(Env *env, char *varname, Value value) {
+    unsigned mask = env->record_capacity - 1;
+    unsigned slot = INTERN_SYMBOL_HASH(varname) & mask;
+
+    while (env->records[slot].varname != NULL) slot = (slot + 1) & mask;
+    env->records[slot].varname = varname;
+    env->records[slot].value = value;
+}
+
+// make room for one more record. the inline array doubles up to
+// ENV_INLINE, past that the records move to a hash table that is kept
+// at most half full
+static void env_grow_records(Env *env) {
+    int count = env->record_count;
+
+    if (count < ENV_INLINE) {
+        if (count < env->record_capacity) return;
+
+        env->record_capacity = count == 0 ? 2 : count * 2;
+        env->records = realloc(
+            env->records, env->record_capacity * sizeof(struct Record));
+        return;
+    }
+
+    if ((count + 1) * 2 <= env->record_capacity) return;
+
+    struct Record *old = env->records;
+    int old_capacity = env->record_capacity;
+    int hashed = old_capacity > ENV_INLINE;
+
+    env->record_capacity = hashed ? old_capacity * 2 : ENV_INLINE * 4;
+    env->records = calloc(env->record_capacity, sizeof(struct Record));
+
+    for (int i = 0; i < (hashed ? old_capacity : count); i++) {
+        if (old[i].varname == NULL) continue;
+        env_place_record(env, old[i].varname, old[i].value);
+    }
+
+    free(old);
+}
+
+void env_insert_var(Env **env, char *varname, Value value) {
+    struct Record *record = env_find_record(*env, varname);
+
+    if (record != NULL) {
+        record->value = value;
+        return;
+    }
+
+    env_grow_records(*env);
+    if ((*env)->record_capacity <= ENV_INLINE) {
+        record = &(*env)->records[(*env)->record_count];
+        record->varname = varname;
+        record->value = value;
+    } else {
+        env_place_record(*env, varname, value);
+    }
+    (*env)->record_count++;
+}
+
+int env_check_var(Env *env, char *varname) {
+    for (Env *env_ptr = env; env_ptr != NULL; env_ptr = env_ptr->parent) {
+        if (env_find_record(env_ptr, varname) != NULL) return 1;
     }
 
     return 0;
 }
 
-AstNode *env_find_var(Env *env, char *varname) {
-    struct Env dup = *env;
-    struct Env *env_ptr = &dup;
-     
-    while (env_ptr != NULL) {
-        while (env_ptr->records != NULL) {
-            if (strcmp(env_ptr->records->varname, varname) == 0) {
-                return env_ptr->records->value;
-            }
-            env_ptr->records = env_ptr->records->next;
-        }
+Value env_find_var(Env *env, char *varname) {
+    for (Env *env_ptr = env; env_ptr != NULL; env_ptr = env_ptr->parent) {
+        struct Record *record = env_find_record(env_ptr, varname);
+        if (record != NULL) return record->value;
+    }
 
-        env_ptr = env_ptr->parent;
+    return VALUE_UNDEFINED;
+}
+
+static void env_retain_value(Value value, Arena *from);
+
+// retain a closure's fn and the closures it captured. the fn no longer
+// being in 'from' marks closures that were already done, which ends the
+// walk for fns that capture themselves. code the vm compiled points into
+// the old tree, so it is compiled again
+static void env_retain_closure(Closure *closure, Arena *from) {
+    if (!arena_contains(from, closure->fn)) return;
+    closure->fn = ast_copy(closure->fn, from);
+    closure->code = NULL;
+
+    if (closure->env == NULL) return;
+    for (int i = 0; i < closure->env->slot_count; i++) {
+        env_retain_value(closure->env->slots[i], from);
     }
 }
 
-void env_insert_builtin(Env **env, AstNode *cfn) {
-    struct Records *record = malloc(sizeof(struct Records));
+// strings own their bytes, only closures point into a tree
+static void env_retain_value(Value value, Arena *from) {
+    if (VALUE_IS(value, OBJ_CLOSURE)) {
+        env_retain_closure(VALUE_AS_CLOSURE(value), from);
+    } else if (VALUE_IS(value, OBJ_CELL)) {
+        env_retain_value(VALUE_AS_CELL(value)->value, from);
+    }
+}
+
+void env_retain_values(Env *env, Arena *from) {
+    int size = env->record_capacity > ENV_INLINE
+        ? env->record_capacity : env->record_count;
 
-    record->varname = cfn->value.ident_name;
-    record->value = cfn;
-    record->next = (*env)->records;
+    for (int i = 0; i < size; i++) {
+        struct Record *record = &env->records[i];
+        if (record->varname == NULL) continue;
+        env_retain_value(record->value, from);
+    }
+}
 
-    (*env)->records = record;
+void env_insert_builtin(Env **env, Value cfn) {
+    env_insert_var(env, VALUE_AS_CFN(cfn)->name, cfn);
 }
 
 // any new builtin function is inserted to global env through this func
 void env_insert_global_builtin(Env **env) {
-    env_insert_builtin(env, ast_init_cfn("puts", &builtin_puts));
-    env_insert_builtin(env, ast_init_cfn("gets", &builtin_gets));
+    env_insert_builtin(
+        env, value_init_cfn(intern_string("puts"), &builtin_puts));
+    env_insert_builtin(
+        env, value_init_cfn(intern_string("gets"), &builtin_gets));
 }
 
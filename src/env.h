@@ -1,33 +1,65 @@
 #ifndef ENV_H
 #define ENV_H
 
-#include "ast.h"
+#include "value.h"
 
-// records structure that holds variables as string and
-// their value as ast node
-struct Records {
+// bindings by name of an env at most this many are searched in order,
+// more are kept in a hash table
+#define ENV_INLINE 8
+
+// record that binds a variable as interned symbol to its value,
+// varname is NULL for an empty slot of the hash table
+struct Record {
     char *varname;
-    AstNode *value;
-    struct Records *next;
+    Value value;
 };
 
-// env structure, contains records of the current env, and a reference
-// to the parent env
+// env structure, contains the variables bound by name, and a reference
+// to the parent env. 'records' is an array of 'record_count' records
+// while there are at most ENV_INLINE of them, then an open addressing
+// hash table of 'record_capacity' records. frames of fn calls and blocks
+// hold their variables in 'slots' instead, at the indexes the resolver
+// assigned, and so do the frames of the variables closures captured.
+// envs made by create_frame are collected, see gc.h
 typedef struct Env {
-    struct Records *records;
+    Object object;
+    struct Record *records;
+    int record_count;
+    int record_capacity;
     struct Env *parent;
+    int slot_count;
+    Value slots[];
 } Env;
 
 // create an empty env with parent as argument
 Env *create_env(Env *parent);
-// insert variable and its value to an env
-void env_insert_var(Env **env, char *varname, AstNode *value);
-// check if a variable is in an env
+// create a frame of 'slot_count' unset slots with parent as argument
+Env *create_frame(Env *parent, int slot_count);
+// same, on the frame stack. frames there are popped in the reverse order
+// they were pushed. closures copy what they capture out of them, so the
+// frames of calls and blocks all go there
+Env *env_push_frame(Env *parent, int slot_count);
+// pop the top frame of the frame stack
+void env_pop_frame(Env *frame);
+// make a closure of 'fn' evaluated in 'env'. the variables it captures
+// are copied into a frame of its own, a block's variable goes into a cell
+// the first time it's captured
+Value env_capture(Env *env, AstNode *fn);
+// call 'visit' with every frame on the frame stack
+void env_visit_frames(void (*visit)(Env *frame));
+// insert variable and its value to an env, replacing a value it bound
+// before
+void env_insert_var(Env **env, char *varname, Value value);
+// check if a variable is in an env, varname must be interned
 int env_check_var(Env *env, char *varname);
-// return value of a variable
-AstNode *env_find_var(Env *env, char *varname);
+// return value of a variable, VALUE_UNDEFINED if it's unbound
+Value env_find_var(Env *env, char *varname);
+// replace the fns of closures an env binds that live in arena 'from'
+// with copies in the current ast arena, so a tree that only the env still
+// uses can be freed. this includes the closures closures captured
+void env_retain_values(Env *env, Arena *from);
 // insert builtin function to an env
-void env_insert_builtin(Env **env, AstNode *cfn);
+void env_insert_builtin(Env **env, Value cfn);
 // uses env_insert_builtin to insert to global env
 void env_insert_global_builtin(Env **env);
 
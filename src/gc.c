@@ -0,0 +1,216 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "gc.h"
+#include "env.h"
+#include "util.h"
+
+// every object the collector may free, newest first
+static Object *objects = NULL;
+// objects are marked with the number of the collection that found them,
+// so marks never have to be cleared. frames on the frame stack, which
+// aren't in 'objects', can't keep a stale mark that way
+static int epoch = 0;
+// marked objects whose children are still to be marked
+static Object **gray = NULL;
+static long gray_count = 0;
+static long gray_capacity = 0;
+
+static Object **roots = NULL;
+static int root_count = 0;
+static void (**markers)(void) = NULL;
+static int marker_count = 0;
+
+static double growth = 2.0;
+static size_t min_heap = 1024 * 1024;
+static GcStats stats = {0, 0, 0, 0, 0, 0, 1024 * 1024};
+
+Value *gc_temps = NULL;
+int gc_temp_count = 0;
+int gc_temp_capacity = 0;
+int gc_due = 0;
+
+void gc_grow_temps(void) {
+    gc_temp_capacity = gc_temp_capacity * 2 + 256;
+    gc_temps = util_grow(gc_temps, gc_temp_capacity, sizeof(Value));
+}
+
+void gc_configure(double heap_growth, size_t heap_min) {
+    growth = heap_growth < 1 ? 1 : heap_growth;
+    min_heap = heap_min;
+    stats.heap_limit = min_heap;
+}
+
+// bytes an object takes, as gc_alloc was asked for them
+static size_t gc_object_size(Object *object) {
+    switch (object->type) {
+        case OBJ_STRING:
+            return sizeof(struct String) + ((String *)object)->length + 1;
+        case OBJ_CLOSURE:
+            return sizeof(struct Closure);
+        case OBJ_CFN:
+            return sizeof(struct Cfn);
+        case OBJ_CELL:
+            return sizeof(struct Cell);
+        case OBJ_INT:
+            return sizeof(struct Integer);
+        default:
+            return sizeof(struct Env) +
+                   ((Env *)object)->slot_count * sizeof(Value);
+    }
+}
+
+Object *gc_alloc(int type, size_t size) {
+    if (stats.heap_size + size > stats.heap_limit) gc_collect();
+    return gc_alloc_quiet(type, size);
+}
+
+Object *gc_alloc_quiet(int type, size_t size) {
+    Object *object = malloc(size);
+    if (object == NULL) {
+        puts("out of memory");
+        exit(1);
+    }
+
+    object->type = type;
+    object->marked = 0;
+    object->next = objects;
+    objects = object;
+
+    stats.heap_size += size;
+    stats.bytes_allocated += size;
+    if (stats.heap_size > stats.heap_limit) gc_due = 1;
+    return object;
+}
+
+Value gc_pin(Value value) {
+    if (VALUE_IS_OBJ(value)) VALUE_AS_OBJ(value)->marked = GC_PINNED;
+    return value;
+}
+
+void gc_add_root(Object *object) {
+    roots = util_grow(roots, root_count + 1, sizeof(Object *));
+    roots[root_count++] = object;
+}
+
+void gc_add_marker(void (*marker)(void)) {
+    markers = util_grow(markers, marker_count + 1, sizeof(*markers));
+    markers[marker_count++] = marker;
+}
+
+void gc_mark_object(Object *object) {
+    if (object == NULL || object->marked >= epoch) return;
+    object->marked = epoch;
+
+    if (object->type == OBJ_STRING || object->type == OBJ_CFN ||
+        object->type == OBJ_INT) {
+        return;
+    }
+    if (gray_count == gray_capacity) {
+        gray_capacity = gray_capacity * 2 + 256;
+        gray = util_grow(gray, gray_capacity, sizeof(Object *));
+    }
+    gray[gray_count++] = object;
+}
+
+void gc_mark_value(Value value) {
+    if (VALUE_IS_OBJ(value)) gc_mark_object(VALUE_AS_OBJ(value));
+}
+
+// mark the slots, bindings and parent of a frame
+static void gc_trace_env(Env *env) {
+    for (int i = 0; i < env->slot_count; i++) gc_mark_value(env->slots[i]);
+
+    int size = env->record_capacity > ENV_INLINE
+        ? env->record_capacity : env->record_count;
+    for (int i = 0; i < size; i++) {
+        if (env->records[i].varname != NULL) {
+            gc_mark_value(env->records[i].value);
+        }
+    }
+
+    if (env->parent != NULL) gc_mark_object(&env->parent->object);
+}
+
+// mark the children of gray objects until there are none
+static void gc_trace(void) {
+    while (gray_count > 0) {
+        Object *object = gray[--gray_count];
+
+        if (object->type == OBJ_CLOSURE) {
+            Env *env = ((Closure *)object)->env;
+            if (env != NULL) gc_mark_object(&env->object);
+        } else if (object->type == OBJ_CELL) {
+            gc_mark_value(((Cell *)object)->value);
+        } else {
+            gc_trace_env((Env *)object);
+        }
+    }
+}
+
+static void gc_mark_frame(Env *frame) {
+    gc_mark_object(&frame->object);
+}
+
+// free the objects this collection didn't mark
+static void gc_sweep(void) {
+    Object **link = &objects;
+
+    while (*link != NULL) {
+        Object *object = *link;
+
+        if (object->marked >= epoch) {
+            link = &object->next;
+            continue;
+        }
+
+        *link = object->next;
+        size_t size = gc_object_size(object);
+        stats.heap_size -= size;
+        stats.bytes_collected += size;
+
+        if (object->type == OBJ_ENV) free(((Env *)object)->records);
+        free(object);
+    }
+}
+
+void gc_collect(void) {
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    epoch++;
+    gc_due = 0;
+    for (int i = 0; i < root_count; i++) gc_mark_object(roots[i]);
+    for (int i = 0; i < gc_temp_count; i++) gc_mark_value(gc_temps[i]);
+    env_visit_frames(gc_mark_frame);
+    for (int i = 0; i < marker_count; i++) markers[i]();
+    gc_trace();
+    gc_sweep();
+
+    size_t limit = stats.heap_size * growth;
+    stats.heap_limit = limit > min_heap ? limit : min_heap;
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double pause = (end.tv_sec - start.tv_sec) +
+                   (end.tv_nsec - start.tv_nsec) / 1e9;
+    stats.collections++;
+    stats.pause_total += pause;
+    if (pause > stats.pause_max) stats.pause_max = pause;
+}
+
+GcStats gc_stats(void) {
+    return stats;
+}
+
+void gc_print_stats(void) {
+    fflush(stdout);
+    fprintf(stderr, "gc: %ld collections\n", stats.collections);
+    fprintf(stderr, "gc: pauses %.3f ms total, %.3f ms max, %.3f ms mean\n",
+            stats.pause_total * 1e3, stats.pause_max * 1e3,
+            stats.collections
+                ? stats.pause_total * 1e3 / stats.collections : 0);
+    fprintf(stderr, "gc: %zu bytes allocated, %zu collected\n",
+            stats.bytes_allocated, stats.bytes_collected);
+    fprintf(stderr, "gc: heap %zu bytes live, limit %zu\n",
+            stats.heap_size, stats.heap_limit);
+}
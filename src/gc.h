@@ -0,0 +1,87 @@
+#ifndef GC_H
+#define GC_H
+
+#include <stddef.h>
+#include "value.h"
+
+// precise mark and sweep collector for heap objects and closure frames.
+// it collects when an allocation would take the heap past its limit.
+// what it marks from:
+//   - the roots added with gc_add_root, the global env
+//   - every frame on the frame stack
+//   - the values pushed with gc_push
+//   - whatever the markers added with gc_add_marker mark
+// anything that can allocate may collect, so an engine pushes the values
+// only its c locals hold across such a call
+
+// collector counters, for --gc-stats
+typedef struct GcStats {
+    long collections;
+    // time spent collecting, in seconds
+    double pause_total;
+    double pause_max;
+    size_t bytes_allocated;
+    size_t bytes_collected;
+    // bytes of live objects, and the size the heap may grow to
+    size_t heap_size;
+    size_t heap_limit;
+} GcStats;
+
+// objects gc_pin was called with are marked with this and never freed
+#define GC_PINNED 0x7fffffff
+
+// values held across allocations, only for gc_push and gc_pop
+extern Value *gc_temps;
+extern int gc_temp_count;
+extern int gc_temp_capacity;
+
+// after a collection the heap may grow to 'growth' times the bytes that
+// survived it, but to at least 'min_heap' bytes
+void gc_configure(double growth, size_t min_heap);
+// set when an allocation that couldn't collect took the heap past its
+// limit, until the next collection
+extern int gc_due;
+
+// allocate an object of 'size' bytes, collecting first if it's due
+Object *gc_alloc(int type, size_t size);
+// allocate without collecting, where not every value is rooted. the
+// next gc_alloc or gc_safepoint makes the collection that is due
+Object *gc_alloc_quiet(int type, size_t size);
+// keep the object of a value alive for good, like the code it's a
+// constant of. returns the value
+Value gc_pin(Value value);
+// mark from 'object' in every collection
+void gc_add_root(Object *object);
+// call 'marker' in every collection, to mark the roots only it knows
+void gc_add_marker(void (*marker)(void));
+// mark an object or the object of a value as reachable, for markers
+void gc_mark_object(Object *object);
+void gc_mark_value(Value value);
+// collect now
+void gc_collect(void);
+// counters since startup
+GcStats gc_stats(void);
+// print the counters to stderr
+void gc_print_stats(void);
+
+void gc_grow_temps(void);
+
+// keep a value alive until it's popped
+static inline void gc_push(Value value) {
+    if (gc_temp_count == gc_temp_capacity) gc_grow_temps();
+    gc_temps[gc_temp_count++] = value;
+}
+
+// collect if a collection is due, where every value is rooted as for
+// gc_alloc. engines call it on every call, so a loop that only makes
+// objects with gc_alloc_quiet is collected too
+static inline void gc_safepoint(void) {
+    if (gc_due) gc_collect();
+}
+
+// drop the last 'count' pushed values
+static inline void gc_pop(int count) {
+    gc_temp_count -= count;
+}
+
+#endif
@@ -0,0 +1,153 @@
+#include <stdlib.h>
+#include <string.h>
+#include "intern.h"
+
+// symbol strings are packed into blocks of this size
+#define INTERN_BLOCK (64 * 1024)
+
+// open addressing hash table entry, name is NULL for an empty slot
+struct Symbol {
+    char *name;
+    unsigned hash;
+    int length;
+};
+
+static struct Symbol *table = NULL;
+static long capacity = 0;
+static InternStats stats = {0, 0, 0, 0};
+
+// free space of the block that symbol strings are copied into
+static char *block = NULL;
+static long block_left = 0;
+
+// fnv-1a
+static unsigned intern_hash(const char *name, int length) {
+    unsigned hash = 2166136261u;
+    for (int i = 0; i < length; i++) {
+        hash = (hash ^ (unsigned char)name[i]) * 16777619u;
+    }
+    return hash;
+}
+
+// copy a symbol string into the current block
+static char *intern_copy(const char *name, int length) {
+    if (length + 1 > block_left) {
+        block_left = length + 1 > INTERN_BLOCK ? length + 1 : INTERN_BLOCK;
+        block = malloc(block_left);
+    }
+
+    char *copy = block;
+    memcpy(copy, name, length);
+    copy[length] = '\0';
+
+    block += length + 1;
+    block_left -= length + 1;
+    return copy;
+}
+
+// double the table, rehashing the symbols into it
+static void intern_grow(void) {
+    struct Symbol *old = table;
+    long old_capacity = capacity;
+
+    capacity = capacity == 0 ? 256 : capacity * 2;
+    table = calloc(capacity, sizeof(struct Symbol));
+
+    for (long i = 0; i < old_capacity; i++) {
+        if (old[i].name == NULL) continue;
+
+        long slot = old[i].hash & (capacity - 1);
+        while (table[slot].name != NULL) slot = (slot + 1) & (capacity - 1);
+        table[slot] = old[i];
+    }
+
+    free(old);
+}
+
+char *intern_symbol(const char *name, int length) {
+    // keep the load factor under 1/2
+    if ((stats.symbols + 1) * 2 > capacity) intern_grow();
+
+    unsigned hash = intern_hash(name, length);
+    long slot = hash & (capacity - 1);
+    stats.lookups++;
+
+    while (table[slot].name != NULL) {
+        struct Symbol *symbol = &table[slot];
+        if (symbol->hash == hash && symbol->length == length &&
+            memcmp(symbol->name, name, length) == 0) {
+            stats.bytes_saved += length + 1;
+            return symbol->name;
+        }
+        slot = (slot + 1) & (capacity - 1);
+    }
+
+    table[slot].name = intern_copy(name, length);
+    table[slot].hash = hash;
+    table[slot].length = length;
+
+    stats.symbols++;
+    stats.bytes += length + 1;
+    return table[slot].name;
+}
+
+char *intern_string(const char *name) {
+    return intern_symbol(name, strlen(name));
+}
+
+InternStats intern_stats(void) {
+    return stats;
+}
+
+SymbolTable intern_table_init(void) {
+    SymbolTable table = {NULL, NULL, 0, 0};
+    return table;
+}
+
+long intern_table_find(SymbolTable *self, char *symbol) {
+    if (self->count == 0) return -1;
+
+    long slot = INTERN_SYMBOL_HASH(symbol) & (self->capacity - 1);
+    while (self->symbols[slot] != NULL) {
+        if (self->symbols[slot] == symbol) return self->indexes[slot];
+        slot = (slot + 1) & (self->capacity - 1);
+    }
+    return -1;
+}
+
+// place a symbol in a free slot, the table has room
+static void intern_table_insert(SymbolTable *self, char *symbol, long index) {
+    long slot = INTERN_SYMBOL_HASH(symbol) & (self->capacity - 1);
+    while (self->symbols[slot] != NULL) {
+        slot = (slot + 1) & (self->capacity - 1);
+    }
+    self->symbols[slot] = symbol;
+    self->indexes[slot] = index;
+}
+
+void intern_table_add(SymbolTable *self, char *symbol, long index) {
+    if ((self->count + 1) * 2 > self->capacity) {
+        char **symbols = self->symbols;
+        long *indexes = self->indexes;
+        long capacity = self->capacity;
+
+        self->capacity = capacity ? capacity * 2 : 64;
+        self->symbols = calloc(self->capacity, sizeof(char *));
+        self->indexes = malloc(self->capacity * sizeof(long));
+        for (long i = 0; i < capacity; i++) {
+            if (symbols[i] != NULL) {
+                intern_table_insert(self, symbols[i], indexes[i]);
+            }
+        }
+        free(symbols);
+        free(indexes);
+    }
+
+    intern_table_insert(self, symbol, index);
+    self->count++;
+}
+
+void intern_table_free(SymbolTable *self) {
+    free(self->symbols);
+    free(self->indexes);
+}
@@ -0,0 +1,48 @@
+#ifndef INTERN_H
+#define INTERN_H
+
+#include <stdint.h>
+
+// process wide symbol table. every identifier is interned once, equal
+// names map to the same pointer so they can be compared with ==
+
+// hash of a symbol for tables keyed on symbols, from its address
+#define INTERN_SYMBOL_HASH(symbol) \
+    ((unsigned)((uintptr_t)(symbol) >> 3) * 2654435761u)
+
+// table from symbols to indexes, for the passes that keep what they know
+// of each name in an array. open addressing, grown past half full
+typedef struct SymbolTable {
+    char **symbols;
+    long *indexes;
+    long count;
+    long capacity;
+} SymbolTable;
+
+// interning statistics, for debug_print_symbols
+typedef struct InternStats {
+    long symbols;
+    long lookups;
+    // bytes held by the symbol strings
+    long bytes;
+    // bytes that copying every lookup would have allocated on top
+    long bytes_saved;
+} InternStats;
+
+// return the unique null terminated symbol for 'length' bytes of 'name'
+char *intern_symbol(const char *name, int length);
+// intern a null terminated string
+char *intern_string(const char *name);
+// current statistics
+InternStats intern_stats(void);
+
+// init an empty symbol table
+SymbolTable intern_table_init(void);
+// index of 'symbol' in the table, -1 if it has none
+long intern_table_find(SymbolTable *self, char *symbol);
+// add a symbol that isn't in the table yet
+void intern_table_add(SymbolTable *self, char *symbol, long index);
+// free the table, the symbols stay
+void intern_table_free(SymbolTable *self);
+
+#endif
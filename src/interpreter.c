@@ -2,254 +2,434 @@
 #include <stdlib.h>
 #include <math.h>
 #include "interpreter.h"
+#include "resolver.h"
+#include "gc.h"
+#include "stack.h"
+#include "typer.h"
+
+static Value visitor_visit_node(AstNode *node, Env *env);
+static Value visitor_visit_assignment(AstNode *node, Env *env);
+static Value visitor_visit_var(AstNode *node, Env *env);
+static Value visitor_visit_tail(AstNode *node, Env *env);
+static Value visitor_visit_if(AstNode *node, Env *env, int tail);
+static Value visitor_visit_binop(AstNode *node, Env *env);
+static Value visitor_visit_unop(AstNode *node, Env *env);
+static Value visitor_visit_block(AstNode *node, Env *env, int tail);
+static Value visitor_visit_builtin(AstNode *node, Cfn *cfn, Env *env);
+static Value visitor_visit_fncall(AstNode *node, Env *env);
+
+// env that variables resolved as global are looked up in
+static Env *global_env;
+// calls running that haven't returned, tail calls count as one
+static long depth = 0;
+
+// a call in tail position is left to the fn around it, which runs it in
+// place of itself. its callee and args wait here until then
+static Value *pending = NULL;
+static int pending_count = 0;
+static int pending_capacity = 0;
+
+static void visitor_mark_pending(void) {
+    for (int i = 0; i < pending_count; i++) gc_mark_value(pending[i]);
+}
 
-static int visitor_seek_truth(AstNode *node);
-static AstNode *visitor_visit_node(AstNode *node, Env *env);
-static AstNode *visitor_visit_assignment(AstNode *node, Env *env);
-static AstNode *visitor_visit_var(AstNode *node, Env *env);
-static AstNode *visitor_visit_if(AstNode *node, Env *env);
-static AstNode *visitor_visit_binop(AstNode *node, Env *env);
-static AstNode *visitor_visit_unop(AstNode *node, Env *env);
-static AstNode *visitor_visit_block(AstNode *node, Env *env);
-static AstNode *visitor_visit_builtin(AstNode *node, Env *env);
-static AstNode *visitor_visit_fncall(AstNode *node, Env *env);
+Value visitor_visit_root(struct AstNode **root, int child_count, Env *env) {
+    static int marking = 0;
+    Value value = VALUE_NOOP;
 
-AstNode *visitor_visit_root(struct AstNode **root, int child_count, Env *env) {
-    AstNode *node;
+    if (!marking) {
+        gc_add_marker(visitor_mark_pending);
+        marking = 1;
+    }
 
+    global_env = env;
+    stack_init();
     for (int i = 0; i < child_count; i++) {
-        node = visitor_visit_node(root[i], env);
+        value = visitor_visit_node(root[i], env);
     }
 
-    return node;
+    return value;
 }
 
 // visit node function
-static AstNode *visitor_visit_node(AstNode *node, Env *env) {
+static Value visitor_visit_node(AstNode *node, Env *env) {
     switch (node->type) {
         case AST_NUMBER:
+            return value_num(node->value.num_value);
+        case AST_INTEGER:
+            return value_int(node->value.int_value);
         case AST_STRING:
         case AST_BOOL:
         case AST_NIL:
+            return value_of_literal(node);
         case AST_FN:
-            return node;
+            return env_capture(env, node);
         case AST_ASSIGNMENT:
             return visitor_visit_assignment(node, env);
         case AST_VAR:
             return visitor_visit_var(node, env);
         case AST_IF:
-            return visitor_visit_if(node, env);
+            return visitor_visit_if(node, env, 0);
         case AST_FNCALL:
             return visitor_visit_fncall(node, env);
         case AST_UNOP:
             return visitor_visit_unop(node, env);
         case AST_BLOCK:
-            return visitor_visit_block(node, env);
+            return visitor_visit_block(node, env, 0);
         case AST_BINOP:
             return visitor_visit_binop(node, env);
         default:
-            return ast_init_noop();
+            return VALUE_NOOP;
     }
 }
 
-// returns truthy value of expr, everything except nil and false is truthy
-static int visitor_seek_truth(AstNode *node) {
-    if (node->type == AST_NIL) return 0;
-    else if (node->type == AST_BOOL) return node->value.bool_value;
-    return 1;
+// visit ast_assignment, evaluates the value and binds it to the slot the
+// resolver gave it, or its cell, or to the name in the global env
+static Value visitor_visit_assignment(AstNode *node, Env *env) {
+    AstNode *left = node->assign.left;
+    Value value = visitor_visit_node(node->assign.right, env);
+
+    if (left->var.depth == VAR_GLOBAL) {
+        env_insert_var(&global_env, left->var.name, value);
+        return VALUE_NOOP;
+    }
+
+    Value *slot = &env->slots[left->var.slot];
+    if (left->var.cell && VALUE_IS(*slot, OBJ_CELL)) {
+        VALUE_AS_CELL(*slot)->value = value;
+    } else {
+        *slot = value;
+    }
+
+    return VALUE_NOOP;
 }
 
-// visit ast_assignment, inserts varname and value into env
-static AstNode *visitor_visit_assignment(AstNode *node, Env *env) {
-    env_insert_var(&env, node->left->value.ident_name, node->right);
-    return ast_init_noop();
+// load a variable from its lexical address, VALUE_UNDEFINED while it's
+// unbound
+static Value visitor_load_var(AstNode *node, Env *env) {
+    if (node->var.depth == VAR_GLOBAL) {
+        return env_find_var(global_env, node->var.name);
+    }
+
+    for (int i = 0; i < node->var.depth; i++) env = env->parent;
+    Value value = env->slots[node->var.slot];
+
+    if (node->var.cell && VALUE_IS(value, OBJ_CELL)) {
+        return VALUE_AS_CELL(value)->value;
+    }
+    return value;
 }
 
-// visit variable, gets variable value from env
-static AstNode *visitor_visit_var(AstNode *node, Env *env) {
-    if (env_check_var(env, node->value.ident_name) == 0) {
+// visit variable, gets variable value from its frame
+static Value visitor_visit_var(AstNode *node, Env *env) {
+    Value var = visitor_load_var(node, env);
+
+    if (var == VALUE_UNDEFINED) {
         printf("name \"%s\" is not defined on line %d\n",
-               node->value.ident_name, node->token.line);
+               node->var.name, node->line);
         exit(1);
-    } 
-    
-    AstNode *var = env_find_var(env, node->value.ident_name);
+    }
 
-    if (var->type == AST_FN) {
-        var->value.ident_name = node->value.ident_name;
+    if (VALUE_IS(var, OBJ_CLOSURE)) {
+        VALUE_AS_CLOSURE(var)->name = node->var.name;
     }
 
-    return visitor_visit_node(var, env);
+    return var;
 }
 
 // visit ast_if, get truthy value of condition. if truthy visit then
-// branch, else visit else branch
-static AstNode *visitor_visit_if(AstNode *node, Env *env) {
-    AstNode *cond = visitor_visit_node(node->condition, env);
-    int truth = visitor_seek_truth(cond);
-
-    if (truth) {
-        return visitor_visit_node(node->then_branch, env);
-    }
-
-    return visitor_visit_node(node->else_branch, env);
-}
-
-// visit binary node, return new node that is the result of the operation
-static AstNode *visitor_visit_binop(AstNode *node, Env *env) {
-    AstNode *left = visitor_visit_node(node->left, env);
-    AstNode *right = visitor_visit_node(node->right, env);
-    AstNode *result;
-
-    switch (node->op.type) {
-        case TOKEN_PLUS:
-            result = ast_init_num(
-                left->value.num_value + right->value.num_value);
-            return result;
-        case TOKEN_MINUS:
-            result = ast_init_num(
-                left->value.num_value - right->value.num_value);
-            return result;
-        case TOKEN_MUL:
-            result = ast_init_num(
-                left->value.num_value * right->value.num_value);
-            return result;
-        case TOKEN_MOD:
-            result = ast_init_num(
-                fmod(left->value.num_value, right->value.num_value));
-            return result;
-        case TOKEN_DIV:
-            result = ast_init_num(
-                left->value.num_value / right->value.num_value);
-            return result;
-        case TOKEN_LT:
-            result = ast_init_bool(
-                left->value.num_value < right->value.num_value);
-            return result;
-        case TOKEN_GT:
-            result = ast_init_bool(
-                left->value.num_value > right->value.num_value);
-            return result;
-        case TOKEN_LTE:
-            result = ast_init_bool(
-                left->value.num_value <= right->value.num_value);
-            return result;
-        case TOKEN_GTE:
-            result = ast_init_bool(
-                left->value.num_value >= right->value.num_value);
-            return result;
-        case TOKEN_EQUAL:
-            result = ast_init_bool(
-                left->value.num_value == right->value.num_value);
-            return result;
-        case TOKEN_NEQUAL:
-            result = ast_init_bool(
-                left->value.num_value != right->value.num_value);
-            return result;
-        case TOKEN_AND:
-            result = ast_init_bool(
-                left->value.num_value && right->value.num_value);
-            return result;
-        case TOKEN_OR:
-            result = ast_init_bool(
-                left->value.num_value || right->value.num_value);
-            return result;
-    }
-}
-
-// visit unary node, return new node with value of operation
-static AstNode *visitor_visit_unop(AstNode *node, Env *env) {
-    AstNode *result = visitor_visit_node(node->right, env);
-
-    if (node->op.type == TOKEN_BANG) {
-        result->value.bool_value = result->value.bool_value == 1 ? 0 : 1;
-    } else if (node->op.type == TOKEN_MINUS) {
-        result->value.num_value *= -1;
-    }
-
-    return result; 
-}
-
-// visit block statement (still doesn't work)
-static AstNode *visitor_visit_block(AstNode *node, Env *env) {
-    AstNode *expr;
-    Env *local_env = create_env(env);
-    
-    for (int i = 0; i < node->child_count; i++) {
-        expr = visitor_visit_node(node->children[i], local_env);
-    }
-    
-    return expr;
+// branch, else visit else branch. the branches of an if in tail position
+// are in tail position
+static Value visitor_visit_if(AstNode *node, Env *env, int tail) {
+    Value cond = visitor_visit_node(node->if_expr.condition, env);
+    AstNode *branch = value_truth(cond)
+        ? node->if_expr.then_branch : node->if_expr.else_branch;
+
+    if (tail) return visitor_visit_tail(branch, env);
+    return visitor_visit_node(branch, env);
+}
+
+// value of an operator on operands as numbers
+static Value visitor_arith(int op, double l, double r) {
+    switch (op) {
+        case TOKEN_PLUS:   return value_num(l + r);
+        case TOKEN_MINUS:  return value_num(l - r);
+        case TOKEN_MUL:    return value_num(l * r);
+        case TOKEN_MOD:    return value_num(fmod(l, r));
+        case TOKEN_DIV:    return value_num(l / r);
+        case TOKEN_LT:     return VALUE_BOOL(l < r);
+        case TOKEN_GT:     return VALUE_BOOL(l > r);
+        case TOKEN_LTE:    return VALUE_BOOL(l <= r);
+        case TOKEN_GTE:    return VALUE_BOOL(l >= r);
+        case TOKEN_EQUAL:  return VALUE_BOOL(l == r);
+        case TOKEN_NEQUAL: return VALUE_BOOL(l != r);
+        case TOKEN_AND:    return VALUE_BOOL(l && r);
+        default:           return VALUE_BOOL(l || r);
+    }
 }
 
-// visit builtin function(c function pointer), get function pointer
-// and call it with args
-static AstNode *visitor_visit_builtin(AstNode *node, Env *env) {
-    AstNode *cfn = env_find_var(env, node->value.ident_name);
+// value of an operator on two ints, see value.h
+static inline Value visitor_int_arith(int op, int64_t l, int64_t r) {
+    switch (op) {
+        case TOKEN_PLUS:   return value_int_add(l, r);
+        case TOKEN_MINUS:  return value_int_sub(l, r);
+        case TOKEN_MUL:    return value_int_mul(l, r);
+        case TOKEN_MOD:    return value_int_mod(l, r);
+        case TOKEN_DIV:    return value_int_div(l, r);
+        case TOKEN_LT:     return VALUE_BOOL(l < r);
+        case TOKEN_GT:     return VALUE_BOOL(l > r);
+        case TOKEN_LTE:    return VALUE_BOOL(l <= r);
+        case TOKEN_GTE:    return VALUE_BOOL(l >= r);
+        case TOKEN_EQUAL:  return VALUE_BOOL(l == r);
+        case TOKEN_NEQUAL: return VALUE_BOOL(l != r);
+        case TOKEN_AND:    return VALUE_BOOL(l && r);
+        default:           return VALUE_BOOL(l || r);
+    }
+}
 
-    AstNode **evaled_args = malloc(node->arg_count * sizeof(struct AstNode *));
-    for (int i = 0; i < node->arg_count; i++) {
-        evaled_args[i] = visitor_visit_node(node->args[i], env);
+// visit binary node, return the value of the operation. two ints compute
+// as ints, other numbers as doubles, and operands that are not numbers
+// count as one of value_to_num. operands the typer proved bools are
+// taken as they are
+static Value visitor_visit_binop(AstNode *node, Env *env) {
+    Value left = visitor_visit_node(node->binop.left, env);
+
+    Value right;
+
+    // the right operand can allocate, and so collect the left one
+    if (VALUE_IS_OBJ(left)) {
+        gc_push(left);
+        right = visitor_visit_node(node->binop.right, env);
+        gc_pop(1);
+    } else {
+        right = visitor_visit_node(node->binop.right, env);
     }
 
-    return cfn->cfun_ptr(node->arg_count, evaled_args);
+    int op = node->binop.op;
+
+    // numbers the typer proved are two ints that fit in a value or two
+    // doubles, unless one is boxed or they mix
+    switch (node->binop.operands) {
+        case TYPE_NUM:
+            if (VALUE_IS_SMALL_INT(left) && VALUE_IS_SMALL_INT(right)) {
+                return visitor_int_arith(
+                    op, value_as_int(left), value_as_int(right));
+            }
+            if (VALUE_IS_NUM(left) && VALUE_IS_NUM(right)) {
+                return visitor_arith(
+                    op, value_as_num(left), value_as_num(right));
+            }
+            break;
+        case TYPE_BOOL:
+            return visitor_arith(op, left == VALUE_TRUE, right == VALUE_TRUE);
+    }
+
+    if (value_is_int(left) && value_is_int(right)) {
+        return visitor_int_arith(op, value_as_int(left), value_as_int(right));
+    }
+
+    // numbers the typer proved are equal as doubles
+    if (node->binop.operands != TYPE_NUM) {
+        if (op == TOKEN_EQUAL) return VALUE_BOOL(value_equal(left, right));
+        if (op == TOKEN_NEQUAL) return VALUE_BOOL(!value_equal(left, right));
+    }
+    return visitor_arith(op, value_to_num(left), value_to_num(right));
 }
 
-// visit fncall. for named functions :
-// visit func call get the node from env, create local env for function
-// and assign arg values to params, and call visit_node with local env.
-// else if is anonymous function, do the same without getting value from
-// env
-static AstNode *visitor_visit_fncall(AstNode *node, Env *env) {
-    // check if function exists
-    if (node->value.ident_name != NULL) {
-        if (env_check_var(env, node->value.ident_name) == 0) {
-            printf("func \"%s\" is not defined on line %d\n",
-                   node->value.ident_name, node->token.line);
-            exit(1);
-        }
+// visit unary node, return the value of the operation
+static Value visitor_visit_unop(AstNode *node, Env *env) {
+    Value result = visitor_visit_node(node->unop.right, env);
 
-        // get fn ast node
-        AstNode *fn = env_find_var(env, node->value.ident_name);
+    if (node->unop.op == TOKEN_BANG) {
+        return VALUE_BOOL(!value_truth(result));
+    } else if (node->unop.op == TOKEN_MINUS) {
+        return value_neg(result);
+    }
 
-        // if is builtin function
-        if (fn->type == AST_CFN) return visitor_visit_builtin(node, env);
+    return result;
+}
 
-        // check if args count is same as params count
-        if (node->arg_count != fn->param_count) {
-            printf(
-                "invalid number of arguments. fn takes %d args, %d given\n",
-                fn->param_count, node->arg_count);
-            exit(1);
-        }
+// visit block, its lets bind the slots of a frame of its own. the last
+// form of a block in tail position is in tail position
+static Value visitor_visit_block(AstNode *node, Env *env, int tail) {
+    Value expr = VALUE_NOOP;
+    int last = node->block.child_count - 1;
+    Env *local_env = env_push_frame(env, node->block.slot_count);
 
-        // create local scope of function
-        Env *local_env = create_env(env);
+    for (int i = 0; i < last; i++) {
+        visitor_visit_node(node->block.children[i], local_env);
+    }
+    if (last >= 0 && tail) {
+        expr = visitor_visit_tail(node->block.children[last], local_env);
+    } else if (last >= 0) {
+        expr = visitor_visit_node(node->block.children[last], local_env);
+    }
 
-        // insert into local env params with values of args
-        for (int i = 0; i < node->arg_count; i++) {
-            AstNode *arg = visitor_visit_node(node->args[i], env);
-            env_insert_var(&local_env, fn->params[i]->value.ident_name, arg);
-        }
+    env_pop_frame(local_env);
+    return expr;
+}
+
+// visit builtin function(c function pointer), call its function pointer
+// with the args evaluated into a frame on the frame stack
+static Value visitor_visit_builtin(AstNode *node, Cfn *cfn, Env *env) {
+    Env *args = env_push_frame(NULL, node->fncall.arg_count);
+
+    for (int i = 0; i < node->fncall.arg_count; i++) {
+        args->slots[i] = visitor_visit_node(node->fncall.args[i], env);
+    }
+
+    Value result = cfn->cfun_ptr(node->fncall.arg_count, args->slots);
+    env_pop_frame(args);
+    return result;
+}
+
+// evaluate the callee of a call, named or anonymous
+static Value visitor_visit_callee(AstNode *node, Env *env) {
+    if (node->fncall.name == NULL) {
+        return visitor_visit_node(node->fncall.lambda, env);
+    }
+
+    Value callee = visitor_load_var(node->fncall.lambda, env);
+    if (callee == VALUE_UNDEFINED) {
+        printf("func \"%s\" is not defined on line %d\n",
+               node->fncall.name, node->line);
+        exit(1);
+    }
+    return callee;
+}
 
-        return visitor_visit_node(fn->body, local_env);
+// closure a call applies, after checking that the callee is one and
+// takes as many args as the call gives. a lazily parsed body is parsed
+// first
+static Closure *visitor_check_call(AstNode *node, Value callee) {
+    if (!VALUE_IS(callee, OBJ_CLOSURE)) {
+        printf("value called on line %d is not a function\n", node->line);
+        exit(1);
     }
 
-    if (node->arg_count != node->lambda->param_count) {
+    AstNode *fn = VALUE_AS_CLOSURE(callee)->fn;
+
+    // check if args count is same as params count
+    if (node->fncall.arg_count != fn->fn.param_count) {
         printf(
             "invalid number of arguments. fn takes %d args, %d given\n",
-            node->lambda->param_count, node->arg_count);
+            fn->fn.param_count, node->fncall.arg_count);
         exit(1);
     }
 
-    Env *local_env = create_env(env);
+    if (fn->fn.lazy != NULL) resolver_parse_body(fn);
+    return VALUE_AS_CLOSURE(callee);
+}
+
+// run the body of a fn in its frame. a call the body makes in tail
+// position then replaces the fn: its frame takes the place of this one
+// and its body runs in the same loop, so tail calls don't use c stack
+static Value visitor_run_fn(AstNode *fn, Env *frame) {
+    while (1) {
+        gc_safepoint();
+        Value result = visitor_visit_tail(fn->fn.body, frame);
+        env_pop_frame(frame);
+        if (result != VALUE_TAIL_CALL) return result;
+
+        Closure *closure = VALUE_AS_CLOSURE(pending[0]);
+        fn = closure->fn;
+        frame = env_push_frame(closure->env, fn->fn.param_count);
+
+        for (int i = 0; i < fn->fn.param_count; i++) {
+            frame->slots[i] = pending[i + 1];
+        }
+        pending_count = 0;
+    }
+}
+
+// visit a call in tail position. a builtin is called right away, for a
+// closure the callee and args are left pending and VALUE_TAIL_CALL is
+// returned to visitor_run_fn
+static Value visitor_visit_tail_call(AstNode *node, Env *env) {
+    Value callee = visitor_visit_callee(node, env);
+    int arg_count = node->fncall.arg_count;
+
+    if (VALUE_IS(callee, OBJ_CFN)) {
+        return visitor_visit_builtin(node, VALUE_AS_CFN(callee), env);
+    }
+    visitor_check_call(node, callee);
+
+    // evaluating an arg can run another tail call, so the args only move
+    // to 'pending' once they are all known
+    gc_push(callee);
+    for (int i = 0; i < arg_count; i++) {
+        gc_push(visitor_visit_node(node->fncall.args[i], env));
+    }
 
-    for (int i = 0; i < node->arg_count; i++) {
-        AstNode *arg = visitor_visit_node(node->args[i], env);
-        env_insert_var(
-            &local_env, node->lambda->params[i]->value.ident_name, arg);
+    if (arg_count + 1 > pending_capacity) {
+        pending_capacity = arg_count + 1 > 16 ? arg_count + 1 : 16;
+        pending = realloc(pending, pending_capacity * sizeof(Value));
+    }
+    for (int i = 0; i <= arg_count; i++) {
+        pending[i] = gc_temps[gc_temp_count - 1 - arg_count + i];
     }
+    pending_count = arg_count + 1;
+    gc_pop(arg_count + 1);
 
-    return visitor_visit_node(node->lambda->body, local_env);
+    return VALUE_TAIL_CALL;
 }
 
+// visit a node in tail position, where a call leaves the fn around it
+static Value visitor_visit_tail(AstNode *node, Env *env) {
+    switch (node->type) {
+        case AST_IF:
+            return visitor_visit_if(node, env, 1);
+        case AST_BLOCK:
+            return visitor_visit_block(node, env, 1);
+        case AST_FNCALL:
+            return visitor_visit_tail_call(node, env);
+        default:
+            return visitor_visit_node(node, env);
+    }
+}
+
+// a fn and its frame, for running the fn on a new stack segment
+struct Call {
+    AstNode *fn;
+    Env *frame;
+};
+
+static Value visitor_run_call(void *call) {
+    return visitor_run_fn(((struct Call *)call)->fn,
+                          ((struct Call *)call)->frame);
+}
+
+// visit fncall. evaluate the callee to a closure or a builtin. for
+// closures the args are evaluated into the slots of a new frame, whose
+// parent is the frame the fn was evaluated in, and the body is run in it.
+// when the c stack runs low the body runs on a new segment, see stack.h
+static Value visitor_visit_fncall(AstNode *node, Env *env) {
+    Value callee = visitor_visit_callee(node, env);
+
+    // if is builtin function
+    if (VALUE_IS(callee, OBJ_CFN)) {
+        return visitor_visit_builtin(node, VALUE_AS_CFN(callee), env);
+    }
+
+    Closure *closure = visitor_check_call(node, callee);
+    AstNode *fn = closure->fn;
+    Env *local_env = env_push_frame(closure->env, fn->fn.param_count);
+
+    for (int i = 0; i < node->fncall.arg_count; i++) {
+        local_env->slots[i] = visitor_visit_node(node->fncall.args[i], env);
+    }
+
+    if (++depth > stack_max_depth && stack_max_depth > 0) {
+        stack_overflow(node->line);
+    }
+
+    Value result;
+    if (stack_low()) {
+        struct Call call = {fn, local_env};
+        result = stack_call(visitor_run_call, &call);
+    } else {
+        result = visitor_run_fn(fn, local_env);
+    }
+    depth--;
+    return result;
+}
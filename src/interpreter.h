@@ -4,6 +4,6 @@
 #include "env.h"
 
 // visitor every node in root node
-AstNode *visitor_visit_root(AstNode **root, int child_count, Env *env);
+Value visitor_visit_root(AstNode **root, int child_count, Env *env);
 
 #endif
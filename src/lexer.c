@@ -3,27 +3,83 @@
 #include <string.h>
 #include <ctype.h>
 #include "lexer.h"
+#include "intern.h"
 
-// create token
-static Token create_token(int token_type, char *value, int line) {
-    Token token = {token_type, value, line};
+// keyword spellings, checked when an identifier is scanned
+static const struct {
+    const char *name;
+    int length;
+    int token_type;
+} keywords[] = {
+#define LEXER_KEYWORD_ENTRY(name, spelling) \
+    {spelling, sizeof(spelling) - 1, TOKEN_##name},
+    LEXER_KEYWORDS(LEXER_KEYWORD_ENTRY)
+#undef LEXER_KEYWORD_ENTRY
+};
+
+#define KEYWORD_COUNT (int)(sizeof(keywords) / sizeof(keywords[0]))
+#define KEYWORD_SLOTS 64
+
+// perfect hash table of keywords. each slot holds the index of the only
+// keyword that hashes there or -1, so an identifier is rejected with one
+// length compare, and a keyword confirmed with one memcmp
+static signed char keyword_slots[KEYWORD_SLOTS];
+static int keyword_max_length = 0;
+
+static unsigned keyword_hash(char *ident, int length) {
+    return (length + ident[0] * 2 + ident[length - 1]) & (KEYWORD_SLOTS - 1);
+}
+
+// fill the keyword table, done once. a new keyword that collides with an
+// existing one is reported here, change keyword_hash if that happens
+static void lexer_init_keywords(void) {
+    if (keyword_max_length > 0) return;
+
+    memset(keyword_slots, -1, sizeof(keyword_slots));
+    for (int i = 0; i < KEYWORD_COUNT; i++) {
+        unsigned slot = keyword_hash(
+            (char *)keywords[i].name, keywords[i].length);
+
+        if (keyword_slots[slot] != -1) {
+            printf("error: keywords \"%s\" and \"%s\" share a hash slot\n",
+                   keywords[i].name, keywords[keyword_slots[slot]].name);
+            exit(1);
+        }
+
+        keyword_slots[slot] = i;
+        if (keywords[i].length > keyword_max_length) {
+            keyword_max_length = keywords[i].length;
+        }
+    }
+}
+
+// create token, 'start' is the position of the lexeme in the buffer
+static Token create_token(Lexer *self, int token_type, size_t start,
+                          int length, int line) {
+    Token token = {
+        token_type, self->source->base + start, length, line, NULL};
     return token;
 }
 
-Lexer lexer_init(char *contents) {
+Lexer lexer_init(Source *source) {
     Lexer lexer;
 
-    lexer.contents = contents;
+    lexer.source = source;
+    lexer.contents = source->contents;
+    lexer.length = source->length;
     lexer.pos = 0;
-    lexer.current_char = contents[0];
+    lexer.current_char = lexer.contents[0];
     lexer.line = 1;
+    lexer.scan = scan_kernels();
+    lexer.last_offset = 0;
 
+    lexer_init_keywords();
     return lexer;
 }
 
 // advance to next character in source code
 static void lexer_advance(Lexer *self) {
-    if (self->pos < strlen(self->contents)) {
+    if (self->pos < self->length) {
         if (self->current_char == '\n') self->line++;
 
         self->pos++;
@@ -31,182 +87,238 @@ static void lexer_advance(Lexer *self) {
     }
 }
 
-// advance position while current character is whitespace
+// move to 'p', which the scanning kernels returned
+static void lexer_seek(Lexer *self, const char *p) {
+    self->pos = p - self->contents;
+    self->current_char = *p;
+}
+
+Lexer lexer_init_at(Source *source, Token *token) {
+    Lexer lexer = lexer_init(source);
+
+    lexer.line = token->line;
+    lexer.last_offset = token->offset;
+    lexer_seek(&lexer, lexer.contents + (token->offset - source->base));
+    return lexer;
+}
+
+// skip whitespace and comments, comments run from '#' to the end of the
+// line. a run of comment lines is skipped without recursing
 static void lexer_skip_whitespace(Lexer *self) {
-    while (isspace(self->current_char)) {
-        lexer_advance(self);
+    const char *p = self->scan->whitespace(
+        self->contents + self->pos, &self->line);
+
+    while (*p == '#') {
+        p = self->scan->line(p);
+        p = self->scan->whitespace(p, &self->line);
     }
+
+    lexer_seek(self, p);
 }
 
-// ignore comments
-static void lexer_ignore_comments(Lexer *self) {
-    while (self->current_char != '\n') lexer_advance(self);
-    lexer_skip_whitespace(self);
-    while (self->current_char == '#') lexer_ignore_comments(self);
+// return keyword token type of an identifier, or TOKEN_IDENT
+static int lexer_keyword_type(char *ident, int length) {
+    if (length > keyword_max_length) return TOKEN_IDENT;
+
+    int index = keyword_slots[keyword_hash(ident, length)];
+    if (index == -1 || keywords[index].length != length) return TOKEN_IDENT;
+    if (memcmp(keywords[index].name, ident, length) != 0) return TOKEN_IDENT;
+
+    return keywords[index].token_type;
 }
 
-Token lexer_get_next_token(Lexer *self) {
-    if (self->pos < strlen(self->contents)) {
-        // skip whitespace
-        if (isspace(self->current_char)) lexer_skip_whitespace(self);
+// consume a token of 'length' characters starting at the current one
+static Token lexer_symbol(Lexer *self, int token_type, int length) {
+    Token token = create_token(
+        self, token_type, self->pos, length, self->line);
+    for (int i = 0; i < length; i++) lexer_advance(self);
+    return token;
+}
 
-        // ignore comments
-        if (self->current_char == '#') lexer_ignore_comments(self);
+// scan one token from the buffered source
+static Token lexer_scan_token(Lexer *self) {
+    lexer_skip_whitespace(self);
+
+    if (self->pos < self->length) {
+        size_t start = self->pos;
+        int line = self->line;
 
         // get identifiers and keywods
         if (isalpha(self->current_char)) {
-            char *ident = malloc(1);
-            ident[0] = '\0';
-
-            while (isalnum(self->current_char) || self->current_char == '_') {
-                char *temp = malloc(2);
-                temp[0] = self->current_char; temp[1] = '\0';
-
-                ident = realloc(ident, (strlen(ident) + 2));
-                strcat(ident, temp);
-                free(temp);
+            lexer_seek(self, self->scan->ident(self->contents + start + 1));
 
-                lexer_advance(self);
-            }
+            int length = self->pos - start;
+            int token_type = lexer_keyword_type(
+                self->contents + start, length);
 
-            int token_type = TOKEN_IDENT;
-
-            if (strcmp(ident, "let") == 0) {
-                token_type = TOKEN_LET;
-            } else if (strcmp(ident, "if") == 0) {
-                token_type = TOKEN_IF;
-            } else if (strcmp(ident, "then") == 0) {
-                token_type = TOKEN_THEN;
-            } else if (strcmp(ident, "else") == 0) {
-                token_type = TOKEN_ELSE;
-            } else if (strcmp(ident, "fn") == 0) {
-                token_type = TOKEN_FN;
-            } else if (strcmp(ident, "true") == 0) {
-                token_type = TOKEN_TRUE;
-            } else if (strcmp(ident, "false") == 0) {
-                token_type = TOKEN_FALSE;
-            } else if (strcmp(ident, "nil") == 0) {
-                token_type = TOKEN_NIL;
-            } else if (strcmp(ident, "and") == 0) {
-                token_type = TOKEN_AND;
-            } else if (strcmp(ident, "or") == 0) {
-                token_type = TOKEN_OR;
-            } else if (strcmp(ident, "do") == 0) {
-                token_type = TOKEN_DO;
-            } else if (strcmp(ident, "done") == 0) {
-                token_type = TOKEN_DONE;
+            Token token = create_token(self, token_type, start, length, line);
+            if (token_type == TOKEN_IDENT) {
+                token.symbol = intern_symbol(self->contents + start, length);
             }
-
-            return create_token(token_type, ident, self->line);
+            return token;
         }
 
-        // get number token
+        // get number or integer token
         if (isdigit(self->current_char)) {
-            char *number = malloc(1);
-            number[0] = '\0';
-
+            int token_type = TOKEN_INTEGER;
             while (isdigit(self->current_char) || self->current_char == '.') {
-                char *temp = malloc(2);
-                temp[0] = self->current_char; temp[1] = '\0';
-                
-                number = realloc(number, (strlen(number) + 2));
-                strcat(number, temp);
-                free(temp);
-
+                if (self->current_char == '.') token_type = TOKEN_NUMBER;
                 lexer_advance(self);
             }
 
-            return create_token(TOKEN_NUMBER, number, self->line);
+            return create_token(
+                self, token_type, start, self->pos - start, line);
         }
 
         // for symbols and string
+        char next = self->contents[self->pos + 1];
         switch (self->current_char) {
-            case '(':
-                lexer_advance(self);
-                return create_token(TOKEN_LPAREN, "(", self->line);
-            case ')':
-                lexer_advance(self);
-                return create_token(TOKEN_RPAREN, ")", self->line);
-            case '+':
-                lexer_advance(self);
-                return create_token(TOKEN_PLUS, "+", self->line);
-            case '*': 
-                lexer_advance(self);
-                return create_token(TOKEN_MUL, "*", self->line);
-            case '/': 
-                lexer_advance(self);
-                return create_token(TOKEN_DIV, "/", self->line);
-            case '%': 
-                lexer_advance(self);
-                return create_token(TOKEN_MOD, "%", self->line);
-            case ';': 
-                lexer_advance(self);
-                return create_token(TOKEN_SEMI, ";", self->line);
-            case ',': 
-                lexer_advance(self);
-                return create_token(TOKEN_COMMA, ",", self->line);
+            case '(': return lexer_symbol(self, TOKEN_LPAREN, 1);
+            case ')': return lexer_symbol(self, TOKEN_RPAREN, 1);
+            case '+': return lexer_symbol(self, TOKEN_PLUS, 1);
+            case '*': return lexer_symbol(self, TOKEN_MUL, 1);
+            case '/': return lexer_symbol(self, TOKEN_DIV, 1);
+            case '%': return lexer_symbol(self, TOKEN_MOD, 1);
+            case ';': return lexer_symbol(self, TOKEN_SEMI, 1);
+            case ',': return lexer_symbol(self, TOKEN_COMMA, 1);
             case '-':
-                lexer_advance(self);
-                if (self->current_char == '>') {
-                    lexer_advance(self);
-                    return create_token(TOKEN_ARROW, "->", self->line);
-                }
-                return create_token(TOKEN_MINUS, "-", self->line);
+                if (next == '>') return lexer_symbol(self, TOKEN_ARROW, 2);
+                return lexer_symbol(self, TOKEN_MINUS, 1);
             case '=':
-                lexer_advance(self);
-                if (self->current_char == '=') {
-                    lexer_advance(self);
-                    return create_token(TOKEN_EQUAL, "==", self->line);
-                }
-                return create_token(TOKEN_ASSIGN, "=", self->line);
+                if (next == '=') return lexer_symbol(self, TOKEN_EQUAL, 2);
+                return lexer_symbol(self, TOKEN_ASSIGN, 1);
             case '!':
-                lexer_advance(self);
-                if (self->current_char == '=') {
-                    lexer_advance(self);
-                    return create_token(TOKEN_NEQUAL, "!=", self->line);
-                }
-                return create_token(TOKEN_BANG, "!", self->line);
+                if (next == '=') return lexer_symbol(self, TOKEN_NEQUAL, 2);
+                return lexer_symbol(self, TOKEN_BANG, 1);
             case '<':
-                lexer_advance(self);
-                if (self->current_char == '=') {
-                    lexer_advance(self);
-                    return create_token(TOKEN_LTE, "<=", self->line);
-                }
-                return create_token(TOKEN_LT, "<", self->line);
+                if (next == '=') return lexer_symbol(self, TOKEN_LTE, 2);
+                return lexer_symbol(self, TOKEN_LT, 1);
             case '>':
-                lexer_advance(self);
-                if (self->current_char == '=') {
-                    lexer_advance(self);
-                    return create_token(TOKEN_GTE, ">=", self->line);
-                }
-                return create_token(TOKEN_GT, ">", self->line);
+                if (next == '=') return lexer_symbol(self, TOKEN_GTE, 2);
+                return lexer_symbol(self, TOKEN_GT, 1);
             case '\"':
-                lexer_advance(self);
-                char *str = malloc(1);
-                str[0] = '\0';
-
-                while (self->current_char != '\"') {
-                    char *temp = malloc(2);
-                    temp[0] = self->current_char; temp[1] = '\0';
+                // the token is the string body, without the quotes
+                start = self->pos + 1;
+                lexer_seek(self, self->scan->string(
+                    self->contents + start, &self->line));
 
-                    str = realloc(str, (strlen(str) + 2));
-                    strcat(str, temp);
-                    free(temp);
+                if (self->current_char != '\"') {
+                    // the rest of the string may still be in the stream
+                    if (self->source->fd != -1) break;
 
-                    lexer_advance(self);
+                    printf("error: unterminated string at line %d\n", line);
+                    exit(1);
                 }
 
+                Token token = create_token(
+                    self, TOKEN_STRING, start, self->pos - start, line);
                 lexer_advance(self);
-                return create_token(TOKEN_STRING, str, self->line);
-            // as a result of skipping ws
-            case '\0': break;
+                return token;
             default:
                 printf("error: unexpected character '%c' at line %d\n",
                         self->current_char, self->line);
-        }       
+        }
     }
 
     // finally return eof token
-    return create_token(TOKEN_EOF, "\0", self->line - 1);
+    return create_token(self, TOKEN_EOF, self->pos, 0, self->line - 1);
 }
 
+// read more of a streaming source. the last returned token is kept in
+// the buffer, the parser may still need its text
+static void lexer_refill(Lexer *self) {
+    size_t offset = self->source->base + self->pos;
+
+    source_refill(self->source, self->last_offset);
+
+    self->contents = self->source->contents;
+    self->length = self->source->length;
+    self->pos = offset - self->source->base;
+    self->current_char = self->contents[self->pos];
+}
+
+Token lexer_get_next_token(Lexer *self) {
+    while (1) {
+        size_t pos = self->pos;
+        int line = self->line;
+        Token token = lexer_scan_token(self);
+
+        // a token that runs into the end of a partly read stream may be
+        // cut short, so read more and scan it again
+        if (self->pos < self->length || self->source->fd == -1) {
+            self->last_offset = token.offset;
+            return token;
+        }
+
+        self->pos = pos;
+        self->line = line;
+        lexer_refill(self);
+    }
+}
+
+char *lexer_token_text(Lexer *self, Token *token) {
+    return self->contents + (token->offset - self->source->base);
+}
+
+char *lexer_token_str(Lexer *self, Token *token) {
+    char *str = malloc(token->length + 1);
+
+    memcpy(str, lexer_token_text(self, token), token->length);
+    str[token->length] = '\0';
+
+    return str;
+}
+
+double lexer_token_num(Lexer *self, Token *token) {
+    // number lexemes are short, copy so strtod stops at the slice end
+    char buffer[64];
+    int length = token->length < 63 ? token->length : 63;
+
+    memcpy(buffer, lexer_token_text(self, token), length);
+    buffer[length] = '\0';
+
+    return strtod(buffer, NULL);
+}
+
+int lexer_token_int(Lexer *self, Token *token, int64_t *integer) {
+    char *text = lexer_token_text(self, token);
+    int64_t value = 0;
+
+    for (int i = 0; i < token->length; i++) {
+        if (__builtin_mul_overflow(value, 10, &value) ||
+            __builtin_add_overflow(value, text[i] - '0', &value)) {
+            return 0;
+        }
+    }
+
+    *integer = value;
+    return 1;
+}
+
+const char *lexer_token_lexeme(int token_type) {
+    switch (token_type) {
+#define LEXER_KEYWORD_CASE(name, spelling) \
+        case TOKEN_##name: return spelling;
+        LEXER_KEYWORDS(LEXER_KEYWORD_CASE)
+#undef LEXER_KEYWORD_CASE
+        case TOKEN_LPAREN: return "(";
+        case TOKEN_RPAREN: return ")";
+        case TOKEN_SEMI:   return ";";
+        case TOKEN_ASSIGN: return "=";
+        case TOKEN_EQUAL:  return "==";
+        case TOKEN_NEQUAL: return "!=";
+        case TOKEN_LT:     return "<";
+        case TOKEN_LTE:    return "<=";
+        case TOKEN_GT:     return ">";
+        case TOKEN_GTE:    return ">=";
+        case TOKEN_ARROW:  return "->";
+        case TOKEN_MOD:    return "%";
+        case TOKEN_COMMA:  return ",";
+        case TOKEN_BANG:   return "!";
+        case TOKEN_PLUS:   return "+";
+        case TOKEN_MINUS:  return "-";
+        case TOKEN_MUL:    return "*";
+        case TOKEN_DIV:    return "/";
+        default:           return NULL;
+    }
+}
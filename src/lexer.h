@@ -1,17 +1,31 @@
 #ifndef LEXER_H
 #define LEXER_H
 
-// token structure, contains token type, lexeme and its line number
+#include <stddef.h>
+#include <stdint.h>
+#include "scan.h"
+#include "source.h"
+
+// keywords and their spelling. a new keyword only needs an entry here,
+// its token type and lexer lookup are generated from this list
+#define LEXER_KEYWORDS(X) \
+    X(LET, "let") X(AND, "and") X(OR, "or") \
+    X(IF, "if") X(THEN, "then") X(ELSE, "else") \
+    X(DO, "do") X(DONE, "done") X(FN, "fn") \
+    X(TRUE, "true") X(FALSE, "false") X(NIL, "nil")
+
+#define LEXER_KEYWORD_ENUM(name, spelling) TOKEN_##name,
+
+// token structure, contains token type, the lexeme as a slice of the
+// source (stream offset and length, nothing is copied), its line number
+// and the symbol of an identifier
 typedef struct Token {
     enum {
-        // literals and identifier
-        TOKEN_NUMBER, TOKEN_STRING, TOKEN_IDENT,
+        // literals and identifier. an integer is a number without a '.'
+        TOKEN_NUMBER, TOKEN_INTEGER, TOKEN_STRING, TOKEN_IDENT,
 
         // keywords
-        TOKEN_LET, TOKEN_AND, TOKEN_OR,
-        TOKEN_IF, TOKEN_THEN, TOKEN_ELSE,
-        TOKEN_DO, TOKEN_DONE, TOKEN_FN,
-        TOKEN_TRUE, TOKEN_FALSE, TOKEN_NIL,
+        LEXER_KEYWORDS(LEXER_KEYWORD_ENUM)
 
         // symbols and operators
         TOKEN_LPAREN, TOKEN_RPAREN, TOKEN_SEMI,
@@ -22,22 +36,46 @@ typedef struct Token {
 
         TOKEN_EOF
     } type;
-    char *value;
+    size_t offset;
+    int length;
     int line;
+    // interned name of an identifier, NULL for other tokens
+    char *symbol;
 } Token;
 
-// lexer structure, contains source code, position of current character,
-// and the character itself
+// lexer structure, contains the source and its buffered contents,
+// position of current character, the character itself, and the
+// scanning kernels
 typedef struct Lexer {
+    Source *source;
     char *contents;
-    int pos;
+    size_t length;
+    size_t pos;
     char current_char;
     int line;
+    const ScanKernels *scan;
+    // stream offset of the last returned token
+    size_t last_offset;
 } Lexer;
 
-// initialize lexer with source code
-Lexer lexer_init(char *contents);
+// initialize lexer with a source
+Lexer lexer_init(Source *source);
+// initialize lexer to scan again from 'token', which must still be in
+// the source's buffer
+Lexer lexer_init_at(Source *source, Token *token);
 // get next token function
 Token lexer_get_next_token(Lexer *self);
+// start of the lexeme of a token. with a streaming source it stays valid
+// until the lexer has returned two more tokens
+char *lexer_token_text(Lexer *self, Token *token);
+// copy the lexeme of a token into a new null terminated string
+char *lexer_token_str(Lexer *self, Token *token);
+// convert the lexeme of a number or integer token to a double
+double lexer_token_num(Lexer *self, Token *token);
+// convert the lexeme of an integer token into 'integer', returns 0 when
+// it's past the range of an int64_t
+int lexer_token_int(Lexer *self, Token *token, int64_t *integer);
+// fixed spelling of keywords and symbols, NULL for literals and idents
+const char *lexer_token_lexeme(int token_type);
 
 #endif
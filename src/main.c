@@ -1,35 +1,108 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
+#include "source.h"
 #include "lexer.h"
 #include "parser.h"
+#include "resolver.h"
+#include "optimizer.h"
+#include "typer.h"
 #include "interpreter.h"
+#include "compiler.h"
+#include "vm.h"
 #include "env.h"
+#include "gc.h"
+#include "stack.h"
 #include "builtin.h"
+#include "debug.h"
+
+// runs the top level forms of a program, returning the last value
+typedef Value (*Engine)(AstNode **root, int child_count, Env *env);
+
+// tree walker unless --engine=vm is given
+static Engine engine = visitor_visit_root;
+// programs are optimized before they're resolved unless --no-opt is given
+static int optimize = 1;
+// largest fn body inlined, in nodes
+static int inline_budget = OPTIMIZER_INLINE_BUDGET;
+// whole files are typed to specialise their operators unless --no-types
+// is given
+static int types = 1;
 
 // main helper funcs
 void readline(char **line);
 void repl(Env *env);
 void print_help(void);
-char *readfile(char *file_location);
+Source open_source(char *file_location);
+void run_file(char *file_location, int lazy, Env *env);
+void run_stream(Env *env);
+void lex_only(char *file_location);
+void parse_only(char *file_location, int flat);
+void dump_opt(char *file_location);
+void dump_types(char *file_location);
 
 int main(int argc, char *argv[]) {
     Env *global_env = create_env(NULL);
+    // the global env holds what every repl line and form keeps
+    gc_add_root(&global_env->object);
     env_insert_global_builtin(&global_env);
 
-    if (argc == 2) {
-        char *contents = readfile(argv[1]);       
-
-        Lexer lexer = lexer_init(contents);
-        // debug_print_tokens(&lexer);
-        Parser parser = parser_init(&lexer);
+    // collector options, a heap growth factor and a minimum in KB
+    double gc_growth = 2.0;
+    long gc_heap = 1024;
 
-        int child_count = 0;
-        AstNode **root = parser_parse_prog(&parser, &child_count);
+    // the engine and its options come before any other argument
+    while (argc > 1) {
+        if (strcmp(argv[1], "--engine=vm") == 0) {
+            engine = vm_run_prog;
+        } else if (strcmp(argv[1], "--engine=tree") == 0) {
+            engine = visitor_visit_root;
+        } else if (strcmp(argv[1], "--dispatch-stats") == 0) {
+            vm_count_dispatches();
+            atexit(vm_print_dispatches);
+        } else if (strcmp(argv[1], "--no-fuse") == 0) {
+            compiler_fuse = 0;
+        } else if (strcmp(argv[1], "--gc-stats") == 0) {
+            atexit(gc_print_stats);
+        } else if (strncmp(argv[1], "--gc-growth=", 12) == 0) {
+            gc_growth = atof(argv[1] + 12);
+        } else if (strncmp(argv[1], "--gc-heap=", 10) == 0) {
+            gc_heap = atol(argv[1] + 10);
+        } else if (strncmp(argv[1], "--max-depth=", 12) == 0) {
+            stack_max_depth = atol(argv[1] + 12);
+        } else if (strcmp(argv[1], "--no-opt") == 0) {
+            optimize = 0;
+        } else if (strncmp(argv[1], "--inline-budget=", 16) == 0) {
+            inline_budget = atoi(argv[1] + 16);
+        } else if (strcmp(argv[1], "--no-types") == 0) {
+            types = 0;
+        } else {
+            break;
+        }
+        argv[1] = argv[0];
+        argv++;
+        argc--;
+    }
+    gc_configure(gc_growth, gc_heap * 1024);
 
-        // debug_print_ast(root, child_count);
-        visitor_visit_root(root, child_count, global_env);
+    if (argc == 3 && strcmp(argv[1], "--lex-only") == 0) {
+        lex_only(argv[2]);
+    } else if (argc == 3 && strcmp(argv[1], "--parse-only") == 0) {
+        parse_only(argv[2], 0);
+    } else if (argc == 3 && strcmp(argv[1], "--parse-flat") == 0) {
+        parse_only(argv[2], 1);
+    } else if (argc == 3 && strcmp(argv[1], "--dump-opt") == 0) {
+        dump_opt(argv[2]);
+    } else if (argc == 3 && strcmp(argv[1], "--dump-types") == 0) {
+        dump_types(argv[2]);
+    } else if (argc == 3 && strcmp(argv[1], "--lazy") == 0) {
+        run_file(argv[2], 1, global_env);
+    } else if (argc == 2 && strcmp(argv[1], "-") == 0) {
+        run_stream(global_env);
+    } else if (argc == 2 && argv[1][0] != '-') {
+        run_file(argv[1], 0, global_env);
     } else if (argc == 1) {
         repl(global_env);
     } else {
@@ -48,15 +121,20 @@ void readline(char **line) {
     }
 }
 
+// each line is parsed into its own arena. after it ran, the values it
+// bound are copied out and the rest of the line's tree is freed
 void repl(Env *env) {
     char *line = NULL;
+    Arena *retained = arena_create();
+
     while (1) {
         printf("|> ");
         readline(&line);
 
         if (strcmp(line, "quit\n") == 0) exit(0);
 
-        Lexer lexer = lexer_init(line);
+        Source source = source_from_string(line);
+        Lexer lexer = lexer_init(&source);
         // debug_print_tokens(&lexer);
 
         Parser parser = parser_init(&lexer);
@@ -64,34 +142,246 @@ void repl(Env *env) {
         int child_count = 0;
         AstNode **root = parser_parse_prog(&parser, &child_count);
         // debug_print_ast(root, child_count);
+        // a later line may bind a fn again or read a name
+        Optimizer optimizer = optimizer_init(parser.arena, 0);
+        optimizer.whole_program = 0;
+        if (optimize) {
+            child_count = optimizer_optimize_prog(
+                &optimizer, root, child_count);
+        }
+
+        // a line may define fns that call names of later lines
+        Resolver resolver = resolver_init(env, parser.arena);
+        resolver.open = 1;
+        if (optimize) resolver.optimizer = &optimizer;
+
+        if (resolver_resolve_prog(&resolver, root, child_count) == 0) {
+            Value result = engine(root, child_count, env);
+            builtin_puts(child_count > 0, &result);
+        }
+        resolver_free(&resolver);
+        optimizer_free(&optimizer);
+
+        Arena *previous = ast_set_arena(retained);
+        env_retain_values(env, parser.arena);
+        ast_set_arena(previous);
+
+        parser_free(&parser);
+        source_close(&source);
+    }
+}
+
+// parse a whole file, then run it. with 'lazy' set fn bodies are only
+// checked up front and parsed when the fn is first called
+void run_file(char *file_location, int lazy, Env *env) {
+    Source source = source_open_file(file_location);
+
+    Lexer lexer = lexer_init(&source);
+    // debug_print_tokens(&lexer);
+    Parser parser = parser_init(&lexer);
+    parser.lazy = lazy;
+
+    int child_count = 0;
+    AstNode **root = parser_parse_prog(&parser, &child_count);
+    // bodies not parsed yet may call and read anything
+    Optimizer optimizer = optimizer_init(parser.arena, 0);
+    optimizer.whole_program = !lazy;
+    optimizer.inline_budget = inline_budget;
+    if (optimize) {
+        child_count = optimizer_optimize_prog(&optimizer, root, child_count);
+    }
+    // the typer has to see every body that can get hold of a value, the
+    // types stay in the operators it annotated
+    if (types && !lazy) {
+        Typer typer = typer_init(0);
+        typer_infer_prog(&typer, root, child_count);
+        typer_free(&typer);
+    }
+
+    // debug_print_ast(root, child_count);
+    Resolver resolver = resolver_init(env, parser.arena);
+    if (optimize) resolver.optimizer = &optimizer;
+    if (resolver_resolve_prog(&resolver, root, child_count) > 0) exit(1);
+
+    engine(root, child_count, env);
 
-        AstNode *result = visitor_visit_root(root, child_count, env);
-        builtin_puts(child_count, &result);
+    if (lazy) {
+        fflush(stdout);
+        fprintf(stderr, "lazy: %ld fn bodies deferred, %ld parsed, "
+                "%ld never parsed\n", parser.lazy_count, parser.lazy_parsed,
+                parser.lazy_count - parser.lazy_parsed);
     }
+    resolver_free(&resolver);
+    optimizer_free(&optimizer);
+    parser_free(&parser);
+}
+
+// evaluate stdin form by form as it arrives, so a long or slow pipe
+// starts running before all of it has been read. a form runs once the
+// first token after it has arrived
+void run_stream(Env *env) {
+    Source source = source_open_stream(0);
+    Lexer lexer = lexer_init(&source);
+    Parser parser = parser_init(&lexer);
+    Optimizer optimizer = optimizer_init(parser.arena, 0);
+    optimizer.whole_program = 0;
+    Resolver resolver = resolver_init(env, parser.arena);
+    resolver.open = 1;
+    if (optimize) resolver.optimizer = &optimizer;
+
+    AstNode *form;
+    while ((form = parser_parse_toplevel(&parser)) != NULL) {
+        if (optimize) form = optimizer_optimize_node(&optimizer, form);
+        if (resolver_resolve_prog(&resolver, &form, 1) > 0) exit(1);
+        engine(&form, 1, env);
+        fflush(stdout);
+    }
+}
+
+// '-' opens stdin as a stream, anything else is mapped as a file
+Source open_source(char *file_location) {
+    if (strcmp(file_location, "-") == 0) return source_open_stream(0);
+    return source_open_file(file_location);
 }
 
 void print_help(void) {
-    puts("usage: scc [file]");
+    puts("usage: scc [--engine=tree|vm] [file]");
+    puts("       scc --engine=vm --dispatch-stats file");
+    puts("                            (count dispatches of each instruction)");
+    puts("       scc --engine=vm --no-fuse file");
+    puts("                            (without superinstructions)");
+    puts("       scc --gc-stats file  (print collector pauses and bytes)");
+    puts("       scc --gc-growth=F --gc-heap=KB file");
+    puts("                            (collect when the heap is F times");
+    puts("                            what survived, and at least KB)");
+    puts("       scc --no-opt file    (run without folding constants");
+    puts("                            or inlining)");
+    puts("       scc --inline-budget=N file");
+    puts("                            (inline fns of up to N nodes, 12 by");
+    puts("                            default, 0 for none)");
+    puts("       scc --no-types file  (run without specialising operators");
+    puts("                            to the types inferred)");
+    puts("       scc --max-depth=N file");
+    puts("                            (error on calls nested deeper than");
+    puts("                            N, 1000000 by default, 0 for none)");
+    puts("       scc -                (run stdin as it streams in)");
+    puts("       scc --lazy file      (parse fn bodies on first call)");
+    puts("       scc --lex-only file  (tokenize only and report MB/s)");
+    puts("       scc --parse-only file  (parse only and report nodes/s)");
+    puts("       scc --parse-flat file  (same, into a flat ast)");
+    puts("       scc --dump-opt file  (print the optimized tree and what");
+    puts("                            was folded, pruned and inlined)");
+    puts("       scc --dump-types file  (print the types inferred for");
+    puts("                            top level lets)");
 }
 
-// read contents of file into a string
-char *readfile(char *file_location) {
-    char *contents;
-    long length = 0;
+// tokenize a whole file without parsing, for measuring lexer throughput
+void lex_only(char *file_location) {
+    Source source = open_source(file_location);
+    Lexer lexer = lexer_init(&source);
+    long token_count = 0;
+    struct timespec start, end;
 
-    FILE *fp = fopen(file_location, "rb");
-    if (fp != NULL) {
-        fseek(fp, 0, SEEK_END);
-        length = ftell(fp);
-        fseek(fp, 0, SEEK_SET);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    while (lexer_get_next_token(&lexer).type != TOKEN_EOF) token_count++;
+    clock_gettime(CLOCK_MONOTONIC, &end);
 
-        contents = malloc(length + 1);
-        if (contents != NULL) fread(contents, 1, length, fp); 
-        fclose(fp);
+    double seconds = (end.tv_sec - start.tv_sec) +
+                     (end.tv_nsec - start.tv_nsec) / 1e9;
+    size_t bytes = source.base + source.length;
+    double megabytes = bytes / (1024.0 * 1024.0);
 
-        return contents;
+    printf("kernels: %s\n", lexer.scan->name);
+    printf("tokens: %ld\n", token_count);
+    printf("bytes: %zu\n", bytes);
+    printf("time: %.6f s\n", seconds);
+    printf("throughput: %.2f MB/s\n", seconds > 0 ? megabytes / seconds : 0);
+    debug_print_symbols();
+}
+
+// parse a whole file without running it, for measuring parser throughput
+// and allocation counts. 'flat' parses into a flat ast instead of a tree
+void parse_only(char *file_location, int flat) {
+    Source source = open_source(file_location);
+    Lexer lexer = lexer_init(&source);
+    struct timespec start, end;
+    int child_count = 0;
+    AstFlat *program = NULL;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    Parser parser = parser_init(&lexer);
+    if (flat) {
+        program = parser_parse_flat(&parser, &child_count);
+    } else {
+        parser_parse_prog(&parser, &child_count);
     }
-    puts("error reading file");
-    exit(1);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    double seconds = (end.tv_sec - start.tv_sec) +
+                     (end.tv_nsec - start.tv_nsec) / 1e9;
+    AstStats stats = ast_stats();
+
+    printf("forms: %d\n", child_count);
+    if (flat) {
+        stats.nodes = program->count;
+        printf("nodes: %u (%zu bytes)\n",
+               program->count, ast_flat_bytes(program));
+    } else {
+        printf("nodes: %ld (%ld bytes)\n", stats.nodes, stats.bytes);
+        printf("arena: %ld allocations, %zu bytes in %ld blocks\n",
+               parser.arena->allocations, parser.arena->bytes,
+               parser.arena->block_count);
+    }
+    printf("time: %.6f s\n", seconds);
+    printf("throughput: %.0f nodes/s\n",
+           seconds > 0 ? stats.nodes / seconds : 0);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if (flat) ast_flat_destroy(program);
+    parser_free(&parser);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    printf("free: %.6f s\n", (end.tv_sec - start.tv_sec) +
+                              (end.tv_nsec - start.tv_nsec) / 1e9);
 }
 
+// parse and optimize a whole file without running it, printing the tree
+// that would run
+void dump_opt(char *file_location) {
+    Source source = open_source(file_location);
+    Lexer lexer = lexer_init(&source);
+    Parser parser = parser_init(&lexer);
+    Optimizer optimizer = optimizer_init(parser.arena, 0);
+    optimizer.inline_budget = inline_budget;
+    int child_count = 0;
+
+    AstNode **root = parser_parse_prog(&parser, &child_count);
+    child_count = optimizer_optimize_prog(&optimizer, root, child_count);
+    debug_print_ast(root, child_count);
+    optimizer_print_stats(&optimizer);
+
+    optimizer_free(&optimizer);
+    parser_free(&parser);
+}
+
+// parse, optimize and type a whole file without running it, printing
+// the type of each name top level lets bind
+void dump_types(char *file_location) {
+    Source source = open_source(file_location);
+    Lexer lexer = lexer_init(&source);
+    Parser parser = parser_init(&lexer);
+    Optimizer optimizer = optimizer_init(parser.arena, 0);
+    optimizer.inline_budget = inline_budget;
+    Typer typer = typer_init(0);
+    int child_count = 0;
+
+    AstNode **root = parser_parse_prog(&parser, &child_count);
+    if (optimize) {
+        child_count = optimizer_optimize_prog(&optimizer, root, child_count);
+    }
+    typer_infer_prog(&typer, root, child_count);
+    typer_print_types(&typer);
+
+    typer_free(&typer);
+    optimizer_free(&optimizer);
+    parser_free(&parser);
+}
@@ -0,0 +1,987 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <math.h>
+#include "optimizer.h"
+#include "intern.h"
+
+Optimizer optimizer_init(Arena *arena, int integral) {
+    Optimizer optimizer;
+
+    optimizer.arena = arena;
+    optimizer.integral = integral;
+    optimizer.whole_program = 1;
+    optimizer.inline_budget = OPTIMIZER_INLINE_BUDGET;
+    optimizer.inlines = NULL;
+    optimizer.inline_count = 0;
+    optimizer.inline_capacity = 0;
+    optimizer.names = intern_table_init();
+    optimizer.locals = NULL;
+    optimizer.local_count = 0;
+    optimizer.local_capacity = 0;
+    optimizer.inlining = 0;
+    optimizer.folded = 0;
+    optimizer.pruned = 0;
+    optimizer.simplified = 0;
+    optimizer.inlined = 0;
+    optimizer.dead_lets = 0;
+    optimizer.effect_lets = 0;
+    optimizer.dead_forms = 0;
+
+    return optimizer;
+}
+
+void optimizer_free(Optimizer *self) {
+    free(self->inlines);
+    intern_table_free(&self->names);
+    free(self->locals);
+}
+
+static int optimizer_is_number(AstNode *node) {
+    return node->type == AST_NUMBER || node->type == AST_INTEGER;
+}
+
+static int optimizer_is_literal(AstNode *node) {
+    return optimizer_is_number(node) || node->type == AST_STRING ||
+           node->type == AST_BOOL || node->type == AST_NIL;
+}
+
+// a literal as an operand of arithmetic, like value_to_num. true and
+// strings count as 1, false and nil as 0
+static double optimizer_num(AstNode *node) {
+    switch (node->type) {
+        case AST_NUMBER:  return node->value.num_value;
+        case AST_INTEGER: return node->value.int_value;
+        case AST_BOOL:    return node->value.bool_value;
+        case AST_STRING: return 1;
+        default:         return 0;
+    }
+}
+
+// truth of a literal, like value_truth. all but nil and false are true
+static int optimizer_truth(AstNode *node) {
+    if (node->type == AST_NIL) return 0;
+    return node->type != AST_BOOL || node->value.bool_value;
+}
+
+// equality of literals, like value_equal
+static int optimizer_equal(AstNode *left, AstNode *right) {
+    if (optimizer_is_number(left) && optimizer_is_number(right) &&
+        left->type != right->type) {
+        return optimizer_num(left) == optimizer_num(right);
+    }
+    if (left->type != right->type) return 0;
+
+    switch (left->type) {
+        case AST_NUMBER:
+            return left->value.num_value == right->value.num_value;
+        case AST_INTEGER:
+            return left->value.int_value == right->value.int_value;
+        case AST_STRING:
+            return strcmp(left->value.str_value, right->value.str_value) == 0;
+        case AST_BOOL:
+            return left->value.bool_value == right->value.bool_value;
+        default:
+            return 1;
+    }
+}
+
+// check if a node is a number literal of 'num'
+static int optimizer_is_num(AstNode *node, double num) {
+    return optimizer_is_number(node) && optimizer_num(node) == num;
+}
+
+// check if a node always evaluates to a number
+static int optimizer_is_numeric(AstNode *node) {
+    switch (node->type) {
+        case AST_NUMBER: case AST_INTEGER:
+            return 1;
+        case AST_UNOP:
+            return node->unop.op == TOKEN_MINUS;
+        case AST_BINOP:
+            switch (node->binop.op) {
+                case TOKEN_PLUS: case TOKEN_MINUS: case TOKEN_MUL:
+                case TOKEN_DIV: case TOKEN_MOD:
+                    return 1;
+            }
+    }
+    return 0;
+}
+
+// check if a literal holds a number the transpiler prints as an int. one
+// with a '.' is a float there
+static int optimizer_is_int(AstNode *node) {
+    return node->type == AST_INTEGER && node->value.int_value >= 0 &&
+           node->value.int_value <= INT_MAX;
+}
+
+// check if ocaml computes the same for operator 'op' over two literals.
+// its arithmetic and comparisons are only over ints, and and or over
+// bools, and == is physical equality
+static int optimizer_is_integral(int op, AstNode *left, AstNode *right) {
+    switch (op) {
+        case TOKEN_PLUS: case TOKEN_MINUS: case TOKEN_MUL:
+            return optimizer_is_int(left) && optimizer_is_int(right);
+        case TOKEN_DIV:
+            // ocaml's quotients are floats, see typer_infer_binop
+            return 0;
+        case TOKEN_MOD:
+            return optimizer_is_int(left) && optimizer_is_int(right) &&
+                   optimizer_num(right) != 0;
+        case TOKEN_LT: case TOKEN_GT: case TOKEN_LTE: case TOKEN_GTE:
+            return optimizer_is_number(left) && optimizer_is_number(right);
+        case TOKEN_EQUAL: case TOKEN_NEQUAL:
+            return left->type == right->type &&
+                   (optimizer_is_number(left) || left->type == AST_BOOL);
+        default:
+            return left->type == AST_BOOL && right->type == AST_BOOL;
+    }
+}
+
+// the node becomes a literal in place, every node has room for one
+static AstNode *optimizer_num_node(AstNode *node, double num) {
+    node->type = AST_NUMBER;
+    node->value.num_value = num;
+    return node;
+}
+
+static AstNode *optimizer_int_node(AstNode *node, int64_t integer) {
+    node->type = AST_INTEGER;
+    node->value.int_value = integer;
+    return node;
+}
+
+static AstNode *optimizer_bool_node(AstNode *node, int truth) {
+    node->type = AST_BOOL;
+    node->value.bool_value = truth;
+    return node;
+}
+
+// arithmetic on two integer literals, as value_int_add and the others
+// compute it. returns 0 when the result is a double
+static int optimizer_int_arith(int op, int64_t l, int64_t r, int64_t *result) {
+    switch (op) {
+        case TOKEN_PLUS:  return !__builtin_add_overflow(l, r, result);
+        case TOKEN_MINUS: return !__builtin_sub_overflow(l, r, result);
+        case TOKEN_MUL:   return !__builtin_mul_overflow(l, r, result);
+        case TOKEN_DIV:
+            if (r == -1) return !__builtin_sub_overflow(0, l, result);
+            if (r == 0 || l % r != 0) return 0;
+            *result = l / r;
+            return 1;
+        default:
+            if (r == 0) return 0;
+            *result = r == -1 ? 0 : l % r;
+            return 1;
+    }
+}
+
+// a binop over literals computes as the interpreter would
+static AstNode *optimizer_fold_binop(Optimizer *self, AstNode *node) {
+    AstNode *left = node->binop.left;
+    AstNode *right = node->binop.right;
+    int op = node->binop.op;
+    double l = optimizer_num(left);
+    double r = optimizer_num(right);
+    double num;
+
+    if (self->integral && !optimizer_is_integral(op, left, right)) {
+        return node;
+    }
+    self->folded++;
+
+    if (left->type == AST_INTEGER && right->type == AST_INTEGER) {
+        int64_t li = left->value.int_value;
+        int64_t ri = right->value.int_value;
+        int64_t integer;
+
+        switch (op) {
+            case TOKEN_PLUS: case TOKEN_MINUS: case TOKEN_MUL:
+            case TOKEN_DIV: case TOKEN_MOD:
+                if (!optimizer_int_arith(op, li, ri, &integer)) break;
+                if (self->integral && (integer < 0 || integer > INT_MAX)) {
+                    self->folded--;
+                    return node;
+                }
+                return optimizer_int_node(node, integer);
+            case TOKEN_LT:  return optimizer_bool_node(node, li < ri);
+            case TOKEN_GT:  return optimizer_bool_node(node, li > ri);
+            case TOKEN_LTE: return optimizer_bool_node(node, li <= ri);
+            case TOKEN_GTE: return optimizer_bool_node(node, li >= ri);
+        }
+    }
+
+    switch (op) {
+        case TOKEN_PLUS:   num = l + r; break;
+        case TOKEN_MINUS:  num = l - r; break;
+        case TOKEN_MUL:    num = l * r; break;
+        case TOKEN_DIV:    num = l / r; break;
+        case TOKEN_MOD:    num = fmod(l, r); break;
+        case TOKEN_LT:     return optimizer_bool_node(node, l < r);
+        case TOKEN_GT:     return optimizer_bool_node(node, l > r);
+        case TOKEN_LTE:    return optimizer_bool_node(node, l <= r);
+        case TOKEN_GTE:    return optimizer_bool_node(node, l >= r);
+        case TOKEN_EQUAL:
+            return optimizer_bool_node(node, optimizer_equal(left, right));
+        case TOKEN_NEQUAL:
+            return optimizer_bool_node(node, !optimizer_equal(left, right));
+        case TOKEN_AND:    return optimizer_bool_node(node, l && r);
+        default:           return optimizer_bool_node(node, l || r);
+    }
+
+    if (self->integral && !(num >= 0 && num <= INT_MAX)) {
+        self->folded--;
+        return node;
+    }
+    return optimizer_num_node(node, num);
+}
+
+// x * 1, 1 * x, x / 1, x + 0, 0 + x and x - 0 are x when x is a number.
+// x + 0 is 0 when x is -0, which prints the same. in ocaml x / 1 is a
+// float, so it's kept when integral
+static AstNode *optimizer_simplify_binop(Optimizer *self, AstNode *node) {
+    AstNode *left = node->binop.left;
+    AstNode *right = node->binop.right;
+    AstNode *result = NULL;
+
+    switch (node->binop.op) {
+        case TOKEN_MUL:
+            if (optimizer_is_num(right, 1)) result = left;
+            else if (optimizer_is_num(left, 1)) result = right;
+            break;
+        case TOKEN_DIV:
+            if (optimizer_is_num(right, 1) && !self->integral) result = left;
+            break;
+        case TOKEN_PLUS:
+            if (optimizer_is_num(right, 0)) result = left;
+            else if (optimizer_is_num(left, 0)) result = right;
+            break;
+        case TOKEN_MINUS:
+            if (optimizer_is_num(right, 0)) result = left;
+            break;
+    }
+
+    if (result == NULL || !optimizer_is_numeric(result)) return node;
+    self->simplified++;
+    return result;
+}
+
+static AstNode *optimizer_fold_unop(Optimizer *self, AstNode *node) {
+    AstNode *right = node->unop.right;
+
+    if (!optimizer_is_literal(right)) return node;
+
+    if (node->unop.op == TOKEN_BANG) {
+        if (self->integral && right->type != AST_BOOL) return node;
+        self->folded++;
+        return optimizer_bool_node(node, !optimizer_truth(right));
+    }
+    // ocaml ints the transpiler prints are never negative
+    if (node->unop.op == TOKEN_MINUS && !self->integral) {
+        int64_t integer;
+        self->folded++;
+        if (right->type == AST_INTEGER &&
+            !__builtin_sub_overflow(0, right->value.int_value, &integer)) {
+            return optimizer_int_node(node, integer);
+        }
+        return optimizer_num_node(node, -optimizer_num(right));
+    }
+    return node;
+}
+
+// an if with a literal condition is the branch it takes
+static AstNode *optimizer_prune_if(Optimizer *self, AstNode *node) {
+    AstNode *cond = node->if_expr.condition;
+
+    if (!optimizer_is_literal(cond)) return node;
+    if (self->integral && cond->type != AST_BOOL) return node;
+
+    self->pruned++;
+    return optimizer_truth(cond)
+        ? node->if_expr.then_branch : node->if_expr.else_branch;
+}
+
+// the fn a top level let binds to 'name', NULL if no let does
+static Inline *optimizer_find(Optimizer *self, char *name) {
+    long index = intern_table_find(&self->names, name);
+    return index < 0 ? NULL : &self->inlines[index];
+}
+
+// count a top level let of 'name', adding it the first time
+static void optimizer_bind(Optimizer *self, char *name) {
+    Inline *entry = optimizer_find(self, name);
+    if (entry != NULL) {
+        entry->bindings++;
+        return;
+    }
+
+    if (self->inline_count == self->inline_capacity) {
+        self->inline_capacity = self->inline_capacity * 2 + 16;
+        self->inlines = realloc(
+            self->inlines, self->inline_capacity * sizeof(struct Inline));
+    }
+
+    entry = &self->inlines[self->inline_count];
+    entry->name = name;
+    entry->fn = NULL;
+    entry->size = 0;
+    entry->bindings = 1;
+    entry->inlined = 0;
+    entry->kept = 0;
+    entry->reason = NULL;
+    intern_table_add(&self->names, name, self->inline_count++);
+}
+
+static void optimizer_push_local(Optimizer *self, char *name) {
+    if (self->local_count == self->local_capacity) {
+        self->local_capacity = self->local_capacity * 2 + 16;
+        self->locals = realloc(
+            self->locals, self->local_capacity * sizeof(char *));
+    }
+    self->locals[self->local_count++] = name;
+}
+
+static int optimizer_is_local(Optimizer *self, char *name) {
+    for (int i = self->local_count - 1; i >= 0; i--) {
+        if (self->locals[i] == name) return 1;
+    }
+    return 0;
+}
+
+// index of a param of 'fn' named 'name', -1 if none is
+static int optimizer_param(AstNode *fn, char *name) {
+    for (int i = 0; i < fn->fn.param_count; i++) {
+        if (fn->fn.params[i]->var.name == name) return i;
+    }
+    return -1;
+}
+
+// args that are literals or variables take the place of params as they
+// are, evaluating them has no effect that could move
+static int optimizer_is_plain(AstNode *node) {
+    return optimizer_is_literal(node) || node->type == AST_VAR;
+}
+
+static int optimizer_add_size(
+    int size, AstNode *node, const char **reason);
+
+// nodes of a body that can be inlined, -1 when it has fns, blocks or
+// lets, with 'reason' set to which. without names of its own, the body's
+// names are its params and globals, and it can be copied anywhere they
+// mean the same
+static int optimizer_inline_size(AstNode *node, const char **reason) {
+    int size = 1;
+
+    switch (node->type) {
+        case AST_NUMBER: case AST_INTEGER: case AST_STRING: case AST_BOOL:
+        case AST_NIL: case AST_VAR:
+            return size;
+        case AST_UNOP:
+            return optimizer_add_size(size, node->unop.right, reason);
+        case AST_BINOP:
+            size = optimizer_add_size(size, node->binop.left, reason);
+            return optimizer_add_size(size, node->binop.right, reason);
+        case AST_IF:
+            size = optimizer_add_size(size, node->if_expr.condition, reason);
+            size = optimizer_add_size(
+                size, node->if_expr.then_branch, reason);
+            return optimizer_add_size(
+                size, node->if_expr.else_branch, reason);
+        case AST_FNCALL:
+            if (node->fncall.name == NULL) {
+                *reason = "body calls an unnamed fn";
+                return -1;
+            }
+            size = optimizer_add_size(size, node->fncall.lambda, reason);
+            for (int i = 0; i < node->fncall.arg_count; i++) {
+                size = optimizer_add_size(
+                    size, node->fncall.args[i], reason);
+            }
+            return size;
+        case AST_FN:
+            *reason = "body has a fn";
+            return -1;
+        case AST_BLOCK:
+            *reason = "body has a block";
+            return -1;
+        default:
+            *reason = "body binds names";
+            return -1;
+    }
+}
+
+static int optimizer_add_size(
+    int size, AstNode *node, const char **reason) {
+    int part = optimizer_inline_size(node, reason);
+    return size < 0 || part < 0 ? -1 : size + part;
+}
+
+// check if a body that can be inlined uses 'name' other than as a param
+// of 'fn', through a shadowing local when 'self' is given
+static int optimizer_uses(
+    Optimizer *self, AstNode *node, AstNode *fn, char *name) {
+    switch (node->type) {
+        case AST_VAR:
+            if (optimizer_param(fn, node->var.name) >= 0) return 0;
+            if (self != NULL) return optimizer_is_local(self, node->var.name);
+            return node->var.name == name;
+        case AST_UNOP:
+            return optimizer_uses(self, node->unop.right, fn, name);
+        case AST_BINOP:
+            return optimizer_uses(self, node->binop.left, fn, name) ||
+                   optimizer_uses(self, node->binop.right, fn, name);
+        case AST_IF:
+            return optimizer_uses(self, node->if_expr.condition, fn, name) ||
+                   optimizer_uses(self, node->if_expr.then_branch, fn, name) ||
+                   optimizer_uses(self, node->if_expr.else_branch, fn, name);
+        case AST_FNCALL:
+            if (optimizer_uses(self, node->fncall.lambda, fn, name)) return 1;
+            for (int i = 0; i < node->fncall.arg_count; i++) {
+                if (optimizer_uses(self, node->fncall.args[i], fn, name)) {
+                    return 1;
+                }
+            }
+    }
+    return 0;
+}
+
+// replace the params of 'fn' in a copy of its body by copies of 'args'
+static AstNode *optimizer_substitute(
+    Optimizer *self, AstNode *node, AstNode *fn, AstNode **args) {
+    int param;
+
+    switch (node->type) {
+        case AST_VAR:
+            param = optimizer_param(fn, node->var.name);
+            if (param < 0) return node;
+            return ast_copy(args[param], self->arena);
+        case AST_UNOP:
+            node->unop.right = optimizer_substitute(
+                self, node->unop.right, fn, args);
+            break;
+        case AST_BINOP:
+            node->binop.left = optimizer_substitute(
+                self, node->binop.left, fn, args);
+            node->binop.right = optimizer_substitute(
+                self, node->binop.right, fn, args);
+            break;
+        case AST_IF:
+            node->if_expr.condition = optimizer_substitute(
+                self, node->if_expr.condition, fn, args);
+            node->if_expr.then_branch = optimizer_substitute(
+                self, node->if_expr.then_branch, fn, args);
+            node->if_expr.else_branch = optimizer_substitute(
+                self, node->if_expr.else_branch, fn, args);
+            break;
+        case AST_FNCALL:
+            node->fncall.lambda = optimizer_substitute(
+                self, node->fncall.lambda, fn, args);
+            node->fncall.name = node->fncall.lambda->type == AST_VAR
+                ? node->fncall.lambda->var.name : NULL;
+            for (int i = 0; i < node->fncall.arg_count; i++) {
+                node->fncall.args[i] = optimizer_substitute(
+                    self, node->fncall.args[i], fn, args);
+            }
+            break;
+    }
+    return node;
+}
+
+// bind an arg to a name no identifier can spell, for the block the body
+// is inlined into. returns the let
+static AstNode *optimizer_bind_arg(
+    Optimizer *self, char *param, AstNode *arg, AstNode **var) {
+    size_t length = strlen(param) + 24;
+    char *fresh = malloc(length);
+    Token token = {.type = TOKEN_ASSIGN, .line = arg->line};
+
+    snprintf(fresh, length, "%s'%ld", param, self->inlined);
+    *var = ast_init_var(intern_string(fresh), token);
+    free(fresh);
+
+    return ast_init_assign(*var, arg, token);
+}
+
+// why the call in 'node' of the fn of 'entry' can't be inlined, NULL
+// when it can
+static const char *optimizer_keep(
+    Optimizer *self, AstNode *node, Inline *entry) {
+    AstNode *fn = entry->fn;
+
+    if (fn == NULL) {
+        return entry->reason != NULL ? entry->reason : "called before its let";
+    }
+    if (node->fncall.arg_count != fn->fn.param_count) {
+        return "called with another number of args";
+    }
+    if (optimizer_uses(self, fn->fn.body, fn, NULL)) {
+        return "uses a global shadowed where it's called";
+    }
+    if (self->integral) {
+        for (int i = 0; i < node->fncall.arg_count; i++) {
+            if (!optimizer_is_plain(node->fncall.args[i])) {
+                return "args aren't literals or variables";
+            }
+        }
+    }
+    return NULL;
+}
+
+// replace a call of a fn by a copy of its body. args that are literals
+// or variables take the place of its params. any other arg is bound to a
+// fresh name by a block around the body, so args still run once, in
+// order and before the body. the copy is optimized again, literals may
+// fold now, but calls in it aren't inlined, which ends mutual recursion
+static AstNode *optimizer_inline_call(Optimizer *self, AstNode *node) {
+    char *name = node->fncall.name;
+
+    if (self->inlining || name == NULL || optimizer_is_local(self, name)) {
+        return node;
+    }
+    Inline *entry = optimizer_find(self, name);
+    if (entry == NULL) return node;
+
+    const char *reason = optimizer_keep(self, node, entry);
+    if (reason != NULL) {
+        entry->kept++;
+        entry->reason = reason;
+        return node;
+    }
+
+    AstNode *fn = entry->fn;
+    int count = fn->fn.param_count;
+    AstNode **args = arena_alloc(self->arena, count * sizeof(AstNode *));
+    AstNode **lets = arena_alloc(self->arena, (count + 1) * sizeof(AstNode *));
+    int let_count = 0;
+    Arena *previous = ast_set_arena(self->arena);
+
+    for (int i = 0; i < count; i++) {
+        AstNode *arg = node->fncall.args[i];
+        if (optimizer_is_plain(arg)) {
+            args[i] = arg;
+        } else {
+            lets[let_count++] = optimizer_bind_arg(
+                self, fn->fn.params[i]->var.name, arg, &args[i]);
+        }
+    }
+
+    AstNode *body = optimizer_substitute(
+        self, ast_copy(fn->fn.body, self->arena), fn, args);
+    if (let_count > 0) {
+        lets[let_count++] = body;
+        body = ast_init_block(lets, let_count);
+        body->line = node->line;
+    }
+    ast_set_arena(previous);
+
+    entry->inlined++;
+    self->inlined++;
+
+    self->inlining = 1;
+    body = optimizer_optimize_node(self, body);
+    self->inlining = 0;
+    return body;
+}
+
+// once the top level let of a fn is optimized, decide if later calls
+// can inline it
+static void optimizer_define(Optimizer *self, AstNode *node) {
+    if (node->type != AST_ASSIGNMENT) return;
+
+    Inline *entry = optimizer_find(self, node->assign.left->var.name);
+    AstNode *fn = node->assign.right;
+    const char *unsized;
+
+    if (fn->type != AST_FN) {
+        entry->reason = "not bound to a fn";
+    } else if (entry->bindings > 1) {
+        entry->reason = "bound by more than one let";
+    } else if (fn->fn.body == NULL) {
+        entry->reason = "body is parsed lazily";
+    } else if ((entry->size = optimizer_inline_size(
+                    fn->fn.body, &unsized)) < 0) {
+        entry->reason = unsized;
+    } else if (entry->size > self->inline_budget) {
+        entry->reason = "body over the size budget";
+    } else if (optimizer_uses(NULL, fn->fn.body, fn, entry->name)) {
+        entry->reason = "recursive";
+    } else {
+        for (int i = 0; i < fn->fn.param_count; i++) {
+            char *param = fn->fn.params[i]->var.name;
+            if (optimizer_param(fn, param) != i) {
+                entry->reason = "repeats a param";
+                return;
+            }
+        }
+        entry->fn = fn;
+    }
+}
+
+// children are optimized first, so folds carry up through the tree. the
+// body of a lazily parsed fn is optimized once it's parsed
+AstNode *optimizer_optimize_node(Optimizer *self, AstNode *node) {
+    int local_count = self->local_count;
+
+    switch (node->type) {
+        case AST_UNOP:
+            node->unop.right = optimizer_optimize_node(self, node->unop.right);
+            return optimizer_fold_unop(self, node);
+        case AST_BINOP:
+            node->binop.left = optimizer_optimize_node(self, node->binop.left);
+            node->binop.right = optimizer_optimize_node(
+                self, node->binop.right);
+            if (optimizer_is_literal(node->binop.left) &&
+                optimizer_is_literal(node->binop.right)) {
+                return optimizer_fold_binop(self, node);
+            }
+            return optimizer_simplify_binop(self, node);
+        case AST_IF:
+            node->if_expr.condition = optimizer_optimize_node(
+                self, node->if_expr.condition);
+            node->if_expr.then_branch = optimizer_optimize_node(
+                self, node->if_expr.then_branch);
+            node->if_expr.else_branch = optimizer_optimize_node(
+                self, node->if_expr.else_branch);
+            return optimizer_prune_if(self, node);
+        case AST_ASSIGNMENT:
+            node->assign.right = optimizer_optimize_node(
+                self, node->assign.right);
+            return node;
+        case AST_BLOCK:
+            // the lets of a block bind their names in all of it
+            for (int i = 0; i < node->block.child_count; i++) {
+                AstNode *child = node->block.children[i];
+                if (child->type == AST_ASSIGNMENT) {
+                    optimizer_push_local(self, child->assign.left->var.name);
+                }
+            }
+            for (int i = 0; i < node->block.child_count; i++) {
+                node->block.children[i] = optimizer_optimize_node(
+                    self, node->block.children[i]);
+            }
+            self->local_count = local_count;
+            return node;
+        case AST_FN:
+            for (int i = 0; i < node->fn.param_count; i++) {
+                optimizer_push_local(self, node->fn.params[i]->var.name);
+            }
+            if (node->fn.body != NULL) {
+                node->fn.body = optimizer_optimize_node(self, node->fn.body);
+            }
+            self->local_count = local_count;
+            return node;
+        case AST_FNCALL:
+            node->fncall.lambda = optimizer_optimize_node(
+                self, node->fncall.lambda);
+            for (int i = 0; i < node->fncall.arg_count; i++) {
+                node->fncall.args[i] = optimizer_optimize_node(
+                    self, node->fncall.args[i]);
+            }
+            return optimizer_inline_call(self, node);
+        default:
+            return node;
+    }
+}
+
+// a name of the program, and whether live code reads it. 'lets' is the
+// first of the pure lets binding it, only live once the name is
+typedef struct Name {
+    char *name;
+    int live;
+    long lets;
+} Name;
+
+typedef struct PureLet {
+    AstNode *value;
+    long next;
+} PureLet;
+
+// liveness of the names of a whole program, by name alone. a read of a
+// name keeps every let of it, in whatever scope, which is never wrong.
+// 'work' holds the names that became live and whose lets are still to be
+// scanned
+typedef struct Liveness {
+    Name *names;
+    long name_count;
+    long name_capacity;
+    SymbolTable indexes;
+    PureLet *lets;
+    long let_count;
+    long let_capacity;
+    char **work;
+    long work_count;
+    long work_capacity;
+} Liveness;
+
+// check if a node can have no effect but its value. calls may print,
+// read input or never return. reading a variable counts as pure, a read
+// of a name not yet bound is only an error when its value is used
+static int optimizer_is_pure(AstNode *node) {
+    switch (node->type) {
+        case AST_FNCALL:
+            return 0;
+        case AST_UNOP:
+            return optimizer_is_pure(node->unop.right);
+        case AST_BINOP:
+            return optimizer_is_pure(node->binop.left) &&
+                   optimizer_is_pure(node->binop.right);
+        case AST_IF:
+            return optimizer_is_pure(node->if_expr.condition) &&
+                   optimizer_is_pure(node->if_expr.then_branch) &&
+                   optimizer_is_pure(node->if_expr.else_branch);
+        case AST_ASSIGNMENT:
+            return optimizer_is_pure(node->assign.right);
+        case AST_BLOCK:
+            for (int i = 0; i < node->block.child_count; i++) {
+                if (!optimizer_is_pure(node->block.children[i])) return 0;
+            }
+            return 1;
+        default:
+            // literals and variables, and fns, which make a closure
+            return 1;
+    }
+}
+
+// the entry of a name, added when 'insert' is set, else NULL if the name
+// has none
+static Name *liveness_find(Liveness *self, char *name, int insert) {
+    long index = intern_table_find(&self->indexes, name);
+    if (index >= 0) return &self->names[index];
+    if (!insert) return NULL;
+
+    if (self->name_count == self->name_capacity) {
+        self->name_capacity = self->name_capacity * 2 + 64;
+        self->names = realloc(
+            self->names, self->name_capacity * sizeof(struct Name));
+    }
+    intern_table_add(&self->indexes, name, self->name_count);
+
+    Name *entry = &self->names[self->name_count++];
+    entry->name = name;
+    entry->live = 0;
+    entry->lets = -1;
+    return entry;
+}
+
+static int liveness_is_live(Liveness *self, char *name) {
+    Name *entry = liveness_find(self, name, 0);
+    return entry != NULL && entry->live;
+}
+
+static void liveness_read(Liveness *self, char *name) {
+    Name *entry = liveness_find(self, name, 1);
+    if (entry->live) return;
+
+    entry->live = 1;
+    if (self->work_count == self->work_capacity) {
+        self->work_capacity = self->work_capacity * 2 + 64;
+        self->work = realloc(
+            self->work, self->work_capacity * sizeof(char *));
+    }
+    self->work[self->work_count++] = name;
+}
+
+// read what the code of a node reads when it runs. the value of a pure
+// let is only read once its name is, until then it waits in 'lets'
+static void liveness_scan(Liveness *self, AstNode *node) {
+    switch (node->type) {
+        case AST_VAR:
+            liveness_read(self, node->var.name);
+            break;
+        case AST_UNOP:
+            liveness_scan(self, node->unop.right);
+            break;
+        case AST_BINOP:
+            liveness_scan(self, node->binop.left);
+            liveness_scan(self, node->binop.right);
+            break;
+        case AST_IF:
+            liveness_scan(self, node->if_expr.condition);
+            liveness_scan(self, node->if_expr.then_branch);
+            liveness_scan(self, node->if_expr.else_branch);
+            break;
+        case AST_BLOCK:
+            for (int i = 0; i < node->block.child_count; i++) {
+                liveness_scan(self, node->block.children[i]);
+            }
+            break;
+        case AST_FN:
+            if (node->fn.body != NULL) liveness_scan(self, node->fn.body);
+            break;
+        case AST_FNCALL:
+            liveness_scan(self, node->fncall.lambda);
+            for (int i = 0; i < node->fncall.arg_count; i++) {
+                liveness_scan(self, node->fncall.args[i]);
+            }
+            break;
+        case AST_ASSIGNMENT: {
+            AstNode *value = node->assign.right;
+            Name *entry = liveness_find(self, node->assign.left->var.name, 1);
+
+            if (entry->live || !optimizer_is_pure(value)) {
+                liveness_scan(self, value);
+                break;
+            }
+            if (self->let_count == self->let_capacity) {
+                self->let_capacity = self->let_capacity * 2 + 64;
+                self->lets = realloc(
+                    self->lets, self->let_capacity * sizeof(struct PureLet));
+            }
+            self->lets[self->let_count].value = value;
+            self->lets[self->let_count].next = entry->lets;
+            entry->lets = self->let_count++;
+            break;
+        }
+    }
+}
+
+// scan the lets of names as they become live, until no more do
+static void liveness_drain(Liveness *self) {
+    while (self->work_count > 0) {
+        Name *entry = liveness_find(self, self->work[--self->work_count], 0);
+        long let = entry->lets;
+
+        entry->lets = -1;
+        while (let >= 0) {
+            PureLet pure = self->lets[let];
+            liveness_scan(self, pure.value);
+            let = pure.next;
+        }
+    }
+}
+
+static void optimizer_sweep_node(
+    Optimizer *self, Liveness *liveness, AstNode *node);
+
+// remove the forms of a list whose value is unused and that have no
+// effect, and lets of names never read. a let whose value has effects
+// is left as just its value. 'keep_last' keeps the last form, the value
+// of a block. returns how many forms are left
+static int optimizer_sweep(Optimizer *self, Liveness *liveness,
+                           AstNode **forms, int count, int keep_last) {
+    int kept = 0;
+
+    for (int i = 0; i < count; i++) {
+        AstNode *form = forms[i];
+
+        if (keep_last && i == count - 1) {
+            // the value of the block
+        } else if (form->type == AST_ASSIGNMENT) {
+            if (liveness_is_live(liveness, form->assign.left->var.name)) {
+                // read somewhere
+            } else if (optimizer_is_pure(form->assign.right)) {
+                self->dead_lets++;
+                continue;
+            } else {
+                self->effect_lets++;
+                form = form->assign.right;
+            }
+        } else if (optimizer_is_pure(form)) {
+            self->dead_forms++;
+            continue;
+        }
+
+        optimizer_sweep_node(self, liveness, form);
+        forms[kept++] = form;
+    }
+    return kept;
+}
+
+static void optimizer_sweep_node(
+    Optimizer *self, Liveness *liveness, AstNode *node) {
+    switch (node->type) {
+        case AST_UNOP:
+            optimizer_sweep_node(self, liveness, node->unop.right);
+            break;
+        case AST_BINOP:
+            optimizer_sweep_node(self, liveness, node->binop.left);
+            optimizer_sweep_node(self, liveness, node->binop.right);
+            break;
+        case AST_IF:
+            optimizer_sweep_node(self, liveness, node->if_expr.condition);
+            optimizer_sweep_node(self, liveness, node->if_expr.then_branch);
+            optimizer_sweep_node(self, liveness, node->if_expr.else_branch);
+            break;
+        case AST_ASSIGNMENT:
+            optimizer_sweep_node(self, liveness, node->assign.right);
+            break;
+        case AST_BLOCK:
+            node->block.child_count = optimizer_sweep(
+                self, liveness, node->block.children,
+                node->block.child_count, 1);
+            break;
+        case AST_FN:
+            if (node->fn.body != NULL) {
+                optimizer_sweep_node(self, liveness, node->fn.body);
+            }
+            break;
+        case AST_FNCALL:
+            optimizer_sweep_node(self, liveness, node->fncall.lambda);
+            for (int i = 0; i < node->fncall.arg_count; i++) {
+                optimizer_sweep_node(self, liveness, node->fncall.args[i]);
+            }
+            break;
+    }
+}
+
+// whole program liveness: what the forms read is live, and what the pure
+// lets of live names read, then the rest is swept. the value of the last
+// form is never used when a whole program runs
+static int optimizer_eliminate(Optimizer *self, AstNode **root, int count) {
+    Liveness liveness = {0};
+
+    for (int i = 0; i < count; i++) liveness_scan(&liveness, root[i]);
+    liveness_drain(&liveness);
+    count = optimizer_sweep(self, &liveness, root, count, 0);
+
+    free(liveness.names);
+    intern_table_free(&liveness.indexes);
+    free(liveness.lets);
+    free(liveness.work);
+    return count;
+}
+
+// the lets of all forms are counted first, a fn is only inlined when a
+// single one binds it. its calls in forms after its let are inlined.
+// dead code is removed once all forms are optimized
+int optimizer_optimize_prog(Optimizer *self, AstNode **root, int count) {
+    int inlining = self->whole_program && self->inline_budget > 0;
+
+    for (int i = 0; inlining && i < count; i++) {
+        if (root[i]->type == AST_ASSIGNMENT) {
+            optimizer_bind(self, root[i]->assign.left->var.name);
+        }
+    }
+
+    for (int i = 0; i < count; i++) {
+        root[i] = optimizer_optimize_node(self, root[i]);
+        if (inlining) optimizer_define(self, root[i]);
+    }
+
+    if (!self->whole_program) return count;
+    return optimizer_eliminate(self, root, count);
+}
+
+void optimizer_print_stats(Optimizer *self) {
+    fflush(stdout);
+    fprintf(stderr, "opt: %ld folded, %ld ifs pruned, %ld simplified, "
+            "%ld calls inlined\n", self->folded, self->pruned,
+            self->simplified, self->inlined);
+    fprintf(stderr, "dce: %ld unused lets removed, %ld left as their value, "
+            "%ld forms without effect removed\n", self->dead_lets,
+            self->effect_lets, self->dead_forms);
+
+    for (long i = 0; i < self->inline_count; i++) {
+        Inline *entry = &self->inlines[i];
+        if (entry->inlined > 0) {
+            fprintf(stderr, "inlined %s (%d nodes) at %ld call%s\n",
+                    entry->name, entry->size, entry->inlined,
+                    entry->inlined == 1 ? "" : "s");
+        }
+        if (entry->kept > 0) {
+            fprintf(stderr, "kept %ld call%s of %s: %s\n", entry->kept,
+                    entry->kept == 1 ? "" : "s", entry->name, entry->reason);
+        }
+    }
+}
@@ -0,0 +1,79 @@
+#ifndef OPTIMIZER_H
+#define OPTIMIZER_H
+
+#include "ast.h"
+#include "arena.h"
+#include "intern.h"
+
+// nodes a fn body may have to be inlined, unless set otherwise
+#define OPTIMIZER_INLINE_BUDGET 12
+
+// a fn bound by a top level let. calls of it in later forms are replaced
+// by its body when it's bound only once, is small and doesn't call
+// itself. 'fn' is set once its let was optimized and it can be inlined,
+// 'reason' tells why the last call of it was kept
+typedef struct Inline {
+    char *name;
+    AstNode *fn;
+    int size;
+    int bindings;
+    long inlined;
+    long kept;
+    const char *reason;
+} Inline;
+
+// rewrites a parsed tree before it is resolved: operators over literals
+// are folded, ifs with a literal condition are replaced by the branch
+// taken, and x * 1, x / 1, x + 0 and x - 0 of a number x become x. calls
+// of small fns are inlined, then lets no code reads and forms whose value
+// is unused and that have no effect are removed. nodes are rewritten in
+// place and new ones allocated from 'arena', so the tree stays in its
+// arena
+typedef struct Optimizer {
+    Arena *arena;
+    // set when the tree is transpiled to ocaml, whose numbers are ints.
+    // only what ints compute the same, and the transpiler can print, is
+    // folded then
+    int integral;
+    // set when optimizer_optimize_prog is given the whole program, the
+    // default. only then it can know which fns are bound once and which
+    // names are never read, so fns are inlined and dead code removed
+    int whole_program;
+    // largest body in nodes that is inlined, 0 to inline nothing
+    int inline_budget;
+    // fns of top level lets in the order they're bound, and their
+    // indexes by name
+    Inline *inlines;
+    long inline_count;
+    long inline_capacity;
+    SymbolTable names;
+    // names bound around the node being optimized. an inlined body can't
+    // use globals that one of them shadows
+    char **locals;
+    int local_count;
+    int local_capacity;
+    // set while an inlined body is optimized, which isn't inlined into
+    int inlining;
+    // counters for --dump-opt
+    long folded;
+    long pruned;
+    long simplified;
+    long inlined;
+    long dead_lets;
+    long effect_lets;
+    long dead_forms;
+} Optimizer;
+
+// init new optimizer allocating from 'arena'
+Optimizer optimizer_init(Arena *arena, int integral);
+// optimize the top level forms of a program in place, returns how many
+// are left
+int optimizer_optimize_prog(Optimizer *self, AstNode **root, int count);
+// optimize a node, returning the node that replaces it
+AstNode *optimizer_optimize_node(Optimizer *self, AstNode *node);
+// print the counters and what was inlined to stderr
+void optimizer_print_stats(Optimizer *self);
+// free the optimizer, nodes stay in the arena
+void optimizer_free(Optimizer *self);
+
+#endif
@@ -5,62 +5,281 @@
 #include "debug.h"
 
 // functions here are recursive, so declared first
-static AstNode *parser_parse_form(Parser *self);
-static AstNode *parser_parse_assignment(Parser *self);
-static AstNode *parser_parse_expr(Parser *self);
-static AstNode *parser_parse_logical_or(Parser *self);
-static AstNode *parser_parse_logical_and(Parser *self);
-static AstNode *parser_parse_equality(Parser *self);
-static AstNode *parser_parse_comparison(Parser *self);
-static AstNode *parser_parse_addition(Parser *self);
-static AstNode *parser_parse_multiplication(Parser *self);
-static AstNode *parser_parse_unary(Parser *self);
-static AstNode *parser_parse_call(Parser *self);
-static AstNode *parser_parse_primary(Parser *self);
+static ParseNode parser_parse_form(Parser *self);
+static ParseNode parser_parse_assignment(Parser *self);
+static ParseNode parser_parse_expr(Parser *self);
+static ParseNode parser_parse_binary(Parser *self, int min_power);
+static ParseNode parser_parse_unary(Parser *self);
+static ParseNode parser_parse_call(Parser *self);
+static ParseNode parser_parse_primary(Parser *self);
 
 Parser parser_init(Lexer *lexer) {
     Parser parser;
 
     parser.lexer = lexer;
     parser.current_token = lexer_get_next_token(parser.lexer);
+    parser.arena = arena_create();
+    parser.flat = NULL;
+    parser.stack = NULL;
+    parser.stack_count = 0;
+    parser.stack_capacity = 0;
+    parser.lazy = 0;
+    parser.checking = 0;
+    parser.lazy_count = 0;
+    parser.lazy_parsed = 0;
 
     return parser;
 }
 
+void parser_free(Parser *self) {
+    arena_destroy(self->arena);
+    free(self->stack);
+}
+
+// push a node on the list stack
+static void parser_push(Parser *self, ParseNode node) {
+    if (self->stack_count == self->stack_capacity) {
+        self->stack_capacity = self->stack_capacity * 2 + 16;
+        self->stack = realloc(
+            self->stack, self->stack_capacity * sizeof(union ParseNode));
+    }
+    self->stack[self->stack_count++] = node;
+}
+
+// pop the nodes pushed since 'start' into a list in the arena, or in
+// the extra array of the flat ast being emitted
+static ParseNode parser_pop_list(Parser *self, int start) {
+    ParseNode list = {NULL};
+    int count = self->stack_count - start;
+
+    if (self->checking) {
+        // nothing to keep
+    } else if (self->flat != NULL) {
+        list.ref = ast_flat_list(self->flat, count);
+        uint32_t *items = self->flat->extra + list.ref + 1;
+        for (int i = 0; i < count; i++) items[i] = self->stack[start + i].ref;
+    } else {
+        // a ParseNode is pointer sized, so the stack is a node array. an
+        // empty list may be popped before the stack is allocated
+        AstNode **nodes = count > 0 ? &self->stack[start].node : NULL;
+        list.list = ast_init_list(nodes, count);
+    }
+
+    self->stack_count = start;
+    return list;
+}
+
+// node constructors, building either a tree node in the arena or a node
+// of the flat ast being emitted. while checking they build nothing
+
+static ParseNode parser_emit_num(Parser *self, Token *token) {
+    ParseNode node = {NULL};
+    if (self->checking) return node;
+
+    double num = lexer_token_num(self->lexer, token);
+    if (self->flat != NULL) node.ref = ast_flat_num(self->flat, num);
+    else node.node = ast_init_num(num);
+    return node;
+}
+
+// an integer past the range of an int64_t is a number
+static ParseNode parser_emit_int(Parser *self, Token *token) {
+    ParseNode node = {NULL};
+    int64_t integer;
+    if (self->checking) return node;
+
+    if (!lexer_token_int(self->lexer, token, &integer)) {
+        return parser_emit_num(self, token);
+    }
+    if (self->flat != NULL) node.ref = ast_flat_int(self->flat, integer);
+    else node.node = ast_init_int(integer);
+    return node;
+}
+
+static ParseNode parser_emit_str(Parser *self, char *string, int length) {
+    ParseNode node = {NULL};
+    if (self->checking) return node;
+    if (self->flat != NULL) {
+        node.ref = ast_flat_str(self->flat, string, length);
+    } else {
+        node.node = ast_init_str(arena_strndup(self->arena, string, length));
+    }
+    return node;
+}
+
+static ParseNode parser_emit_bool(Parser *self, int truth) {
+    ParseNode node = {NULL};
+    if (self->checking) return node;
+    if (self->flat != NULL) node.ref = ast_flat_bool(self->flat, truth);
+    else node.node = ast_init_bool(truth);
+    return node;
+}
+
+static ParseNode parser_emit_nil(Parser *self) {
+    ParseNode node = {NULL};
+    if (self->checking) return node;
+    if (self->flat != NULL) node.ref = ast_flat_nil(self->flat);
+    else node.node = ast_init_nil();
+    return node;
+}
+
+static ParseNode parser_emit_noop(Parser *self) {
+    ParseNode node = {NULL};
+    if (self->checking) return node;
+    if (self->flat != NULL) node.ref = ast_flat_noop(self->flat);
+    else node.node = ast_init_noop();
+    return node;
+}
+
+static ParseNode parser_emit_var(Parser *self, Token token) {
+    ParseNode node = {NULL};
+    if (self->checking) return node;
+    if (self->flat != NULL) {
+        node.ref = ast_flat_var(self->flat, token.symbol, token);
+    } else {
+        node.node = ast_init_var(token.symbol, token);
+    }
+    return node;
+}
+
+static ParseNode parser_emit_unop(Parser *self, ParseNode right, Token op) {
+    ParseNode node = {NULL};
+    if (self->checking) return node;
+    if (self->flat != NULL) node.ref = ast_flat_unop(self->flat, right.ref, op);
+    else node.node = ast_init_unop(right.node, op);
+    return node;
+}
+
+static ParseNode parser_emit_binop(
+    Parser *self, ParseNode left, ParseNode right, Token op) {
+    ParseNode node = {NULL};
+    if (self->checking) return node;
+    if (self->flat != NULL) {
+        node.ref = ast_flat_binop(self->flat, left.ref, right.ref, op);
+    } else {
+        node.node = ast_init_binop(left.node, right.node, op);
+    }
+    return node;
+}
+
+static ParseNode parser_emit_assign(
+    Parser *self, ParseNode left, ParseNode right, Token op) {
+    ParseNode node = {NULL};
+    if (self->checking) return node;
+    if (self->flat != NULL) {
+        node.ref = ast_flat_assign(self->flat, left.ref, right.ref, op);
+    } else {
+        node.node = ast_init_assign(left.node, right.node, op);
+    }
+    return node;
+}
+
+static ParseNode parser_emit_if(
+    Parser *self, ParseNode cond, ParseNode then, ParseNode alter) {
+    ParseNode node = {NULL};
+    if (self->checking) return node;
+    if (self->flat != NULL) {
+        node.ref = ast_flat_if(self->flat, cond.ref, then.ref, alter.ref);
+    } else {
+        node.node = ast_init_if(cond.node, then.node, alter.node);
+    }
+    return node;
+}
+
+// 'children', 'params' and 'args' are lists from parser_pop_list
+static ParseNode parser_emit_block(
+    Parser *self, ParseNode children, int child_count) {
+    ParseNode node = {NULL};
+    if (self->checking) return node;
+    if (self->flat != NULL) node.ref = ast_flat_block(self->flat, children.ref);
+    else node.node = ast_init_block(children.list, child_count);
+    return node;
+}
+
+static ParseNode parser_emit_fn(
+    Parser *self, ParseNode params, int param_count, ParseNode body) {
+    ParseNode node = {NULL};
+    if (self->checking) return node;
+    if (self->flat != NULL) {
+        node.ref = ast_flat_fn(self->flat, params.ref, body.ref);
+    } else {
+        node.node = ast_init_fn(params.list, param_count, body.node);
+    }
+    return node;
+}
+
+static ParseNode parser_emit_fncall(
+    Parser *self, ParseNode callee, ParseNode args, int arg_count) {
+    ParseNode node = {NULL};
+    if (self->checking) return node;
+    if (self->flat != NULL) {
+        node.ref = ast_flat_fncall(self->flat, callee.ref, args.ref);
+        return node;
+    }
+
+    // only calls through a variable are named, others are lambdas
+    AstNode *lambda = callee.node;
+    char *fn_name = lambda->type == AST_VAR ? lambda->value.ident_name : NULL;
+    node.node = ast_init_fncall(fn_name, args.list, arg_count, lambda);
+    return node;
+}
+
 // expect token of type 'token_type', if not token then error
 void parser_eat(Parser *self, int token_type) {
-    if (self->current_token.type == token_type) {
+    if ((int)self->current_token.type == token_type) {
         self->current_token = lexer_get_next_token(self->lexer);
     } else {
         printf("unexpected ");
-        print_tokens(&(self->current_token));
+        print_tokens(self->lexer, &(self->current_token));
         // exit(1);
     }
 }
 
+// parse every form until eof into a list
+static ParseNode parser_parse_forms(Parser *self, int *child_count) {
+    int start = self->stack_count;
+
+    parser_push(self, parser_parse_form(self));
+    while (self->current_token.type != TOKEN_EOF) {
+        parser_push(self, parser_parse_form(self));
+    }
+
+    *child_count = self->stack_count - start;
+    return parser_pop_list(self, start);
+}
+
 // parse every token until eof
 // full grammar in ../bnf
 AstNode **parser_parse_prog(Parser *self, int *child_count) {
-    AstNode **root = malloc(sizeof(struct AstNode *));
-    *child_count = 0;
+    Arena *previous = ast_set_arena(self->arena);
+    AstNode **root = parser_parse_forms(self, child_count).list;
 
-    AstNode *child = parser_parse_form(self);
-    root[*child_count] = child;
-    (*child_count)++;
+    ast_set_arena(previous);
+    return root;
+}
 
-    while (self->current_token.type != TOKEN_EOF) {
-        child = parser_parse_form(self);     
-        root = realloc(root, (*child_count + 1) * sizeof(struct AstNode *));
-        root[*child_count] = child;
-        (*child_count)++;
-    }
+AstFlat *parser_parse_flat(Parser *self, int *child_count) {
+    self->flat = ast_flat_create();
+    self->flat->root = parser_parse_forms(self, child_count).ref;
 
-    return root;
+    AstFlat *flat = self->flat;
+    self->flat = NULL;
+    return flat;
+}
+
+AstNode *parser_parse_toplevel(Parser *self) {
+    if (self->current_token.type == TOKEN_EOF) return NULL;
+
+    Arena *previous = ast_set_arena(self->arena);
+    AstNode *node = parser_parse_form(self).node;
+
+    ast_set_arena(previous);
+    return node;
 }
 
 // grammar for form -> (expression | assignment)
-static AstNode *parser_parse_form(Parser *self) {
-    AstNode *node;
+static ParseNode parser_parse_form(Parser *self) {
+    ParseNode node;
 
     switch (self->current_token.type) {
         case TOKEN_LET:
@@ -68,7 +287,7 @@ static AstNode *parser_parse_form(Parser *self) {
             break;
         case TOKEN_EOF:
             parser_eat(self, TOKEN_EOF);
-            node = ast_init_noop();
+            node = parser_emit_noop(self);
             break;
         default:
             node = parser_parse_expr(self);
@@ -78,53 +297,95 @@ static AstNode *parser_parse_form(Parser *self) {
 }
 
 // grammar for assignment -> 'let' ident = expression
-static AstNode *parser_parse_assignment(Parser *self) {
-    AstNode *node;
+static ParseNode parser_parse_assignment(Parser *self) {
     parser_eat(self, TOKEN_LET);
 
-    AstNode *left = ast_init_var(self->current_token.value, self->current_token);
+    ParseNode left = parser_emit_var(self, self->current_token);
     parser_eat(self, TOKEN_IDENT);
 
     Token op = self->current_token;
     parser_eat(self, TOKEN_ASSIGN);
 
-    node = ast_init_assign(left, parser_parse_expr(self), op);
+    return parser_emit_assign(self, left, parser_parse_expr(self), op);
+}
+
+// build a fn whose body is only checked for now, by parsing it without
+// building anything. where the body starts is kept for parser_parse_body
+static ParseNode parser_defer_fn(
+    Parser *self, ParseNode params, int param_count) {
+    struct LazyBody *lazy = arena_alloc(self->arena, sizeof(struct LazyBody));
+    lazy->parser = self;
+    lazy->start = self->current_token;
+    lazy->scope = NULL;
+
+    self->checking = 1;
+    parser_parse_expr(self);
+    self->checking = 0;
+
+    ParseNode node;
+    node.node = ast_init_lazy_fn(
+        params.list, param_count, lazy, lazy->start.line);
+    self->lazy_count++;
     return node;
 }
 
+void parser_parse_body(AstNode *fn) {
+    struct LazyBody *lazy = fn->fn.lazy;
+    Parser *self = lazy->parser;
+    Lexer *lexer = self->lexer;
+    Token current_token = self->current_token;
+
+    // parse from the start of the body with a lexer of its own, then put
+    // back where the parser had stopped
+    Lexer body_lexer = lexer_init_at(lexer->source, &lazy->start);
+    self->lexer = &body_lexer;
+    self->current_token = lexer_get_next_token(&body_lexer);
+
+    Arena *previous = ast_set_arena(self->arena);
+    fn->fn.body = parser_parse_expr(self).node;
+    ast_set_arena(previous);
+
+    self->lexer = lexer;
+    self->current_token = current_token;
+    fn->fn.lazy = NULL;
+    self->lazy_parsed++;
+}
+
 // grammar for expression ->
 // | 'if' logic_or 'then' expression ('else' expression)?  <- if expression
 // | 'fn' '('params?')' '->' expression  <- function definition / lambda expr
 // | block  <- block expression, evaluates to last expr in block
 // | logic_or
-static AstNode *parser_parse_expr(Parser *self) {
-    AstNode *node;
+static ParseNode parser_parse_expr(Parser *self) {
+    ParseNode node;
+    int start;
+
     switch (self->current_token.type) {
         case TOKEN_IF:
             parser_eat(self, TOKEN_IF);
 
-            AstNode *cond = parser_parse_logical_or(self);
+            ParseNode cond = parser_parse_binary(self, 0);
             parser_eat(self, TOKEN_THEN);
-            AstNode *then = parser_parse_expr(self);
+            ParseNode then = parser_parse_expr(self);
 
-            AstNode *alter = ast_init_nil();
+            ParseNode alter;
             if (self->current_token.type == TOKEN_ELSE) {
                 parser_eat(self, TOKEN_ELSE);
                 alter = parser_parse_expr(self);
+            } else {
+                alter = parser_emit_nil(self);
             }
 
-            node = ast_init_if(cond, then, alter);
+            node = parser_emit_if(self, cond, then, alter);
             break;
         case TOKEN_FN:
             parser_eat(self, TOKEN_FN); 
             parser_eat(self, TOKEN_LPAREN);
 
-            int param_count = 0;
-            struct AstNode **params = malloc(sizeof(struct Token *));
+            start = self->stack_count;
 
             while (self->current_token.type != TOKEN_RPAREN) {
-                params[param_count] = parser_parse_primary(self); 
-                param_count++;
+                parser_push(self, parser_parse_primary(self));
 
                 if (self->current_token.type == TOKEN_COMMA) {
                     parser_eat(self, TOKEN_COMMA);
@@ -134,153 +395,81 @@ static AstNode *parser_parse_expr(Parser *self) {
             parser_eat(self, TOKEN_RPAREN);
             parser_eat(self, TOKEN_ARROW);
 
-            node = ast_init_fn(
-                params, param_count, parser_parse_expr(self));
+            int param_count = self->stack_count - start;
+            ParseNode params = parser_pop_list(self, start);
+
+            if (self->lazy && !self->checking && self->flat == NULL) {
+                node = parser_defer_fn(self, params, param_count);
+            } else {
+                node = parser_emit_fn(
+                    self, params, param_count, parser_parse_expr(self));
+            }
             break;
         case TOKEN_DO:
             parser_eat(self, TOKEN_DO);
-            int child_count = 0;
-            struct AstNode **children = malloc(sizeof(struct AstNode *));
+            start = self->stack_count;
 
             while (self->current_token.type != TOKEN_DONE) {
-                children[child_count] = parser_parse_form(self);
-                child_count++;
+                parser_push(self, parser_parse_form(self));
                 parser_eat(self, TOKEN_SEMI);
             }
             
             parser_eat(self, TOKEN_DONE);
-            node = ast_init_block(children, child_count);
+            int child_count = self->stack_count - start;
+            node = parser_emit_block(
+                self, parser_pop_list(self, start), child_count);
             break;
         default:
-            node = parser_parse_logical_or(self);
-    }
-
-    return node;
-}
-
-// grammar -> logic_and ('or' logic_and)*
-static AstNode *parser_parse_logical_or(Parser *self) {
-    AstNode *node = parser_parse_logical_and(self);
-    while (self->current_token.type == TOKEN_OR) {
-        Token token = self->current_token;
-        parser_eat(self, TOKEN_OR);
-
-        node = ast_init_binop(node, parser_parse_logical_and(self), token);
-    }
-
-    return node;
-}
-
-// grammar -> equality ('and' equality)*
-static AstNode *parser_parse_logical_and(Parser *self) {
-    AstNode *node = parser_parse_equality(self);
-    while (self->current_token.type == TOKEN_AND) {
-        Token token = self->current_token;
-        parser_eat(self, TOKEN_AND);
-
-        node = ast_init_binop(node, parser_parse_equality(self), token);
-    }
-
-    return node;
-}
-
-// grammar -> comparison (('==' | '!=') comparison)*
-static AstNode *parser_parse_equality(Parser *self) {
-    AstNode *node = parser_parse_comparison(self);
-    while (self->current_token.type == TOKEN_EQUAL ||
-           self->current_token.type == TOKEN_NEQUAL) {
-        Token token = self->current_token;
-        
-        if (token.type == TOKEN_EQUAL) {
-            parser_eat(self, TOKEN_EQUAL);
-        } else {
-            parser_eat(self, TOKEN_NEQUAL);
-        }
-
-        node = ast_init_binop(node, parser_parse_comparison(self), token);
-    }
-
-    return node;
-}
-
-// grammar -> addition (('<' | '>' | '<=' | '>=') addition)*
-static AstNode *parser_parse_comparison(Parser *self) {
-    AstNode *node = parser_parse_addition(self);
-    while (self->current_token.type == TOKEN_LT ||
-           self->current_token.type == TOKEN_GT ||
-           self->current_token.type == TOKEN_LTE ||
-           self->current_token.type == TOKEN_GTE) {
-        Token token = self->current_token;
-        
-        switch (token.type) {
-            case TOKEN_LT: parser_eat(self, TOKEN_LT); break;
-            case TOKEN_GT: parser_eat(self, TOKEN_GT); break;
-            case TOKEN_LTE: parser_eat(self, TOKEN_LTE); break;
-            case TOKEN_GTE: parser_eat(self, TOKEN_GTE); break;
-        }
-
-        node = ast_init_binop(node, parser_parse_addition(self), token);
+            node = parser_parse_binary(self, 0);
     }
 
     return node;
 }
 
-// grammar -> multiplication (('+' | '-') multiplication)*
-static AstNode *parser_parse_addition(Parser *self) {
-    AstNode *node = parser_parse_multiplication(self);
-    
-    while (self->current_token.type == TOKEN_PLUS ||
-           self->current_token.type == TOKEN_MINUS) {
+// binding power of the binary operators by token type, 0 for any other
+// token. higher binds tighter, every level is left associative
+static const unsigned char binding_power[TOKEN_EOF + 1] = {
+    [TOKEN_OR] = 1,
+    [TOKEN_AND] = 2,
+    [TOKEN_EQUAL] = 3, [TOKEN_NEQUAL] = 3,
+    [TOKEN_LT] = 4, [TOKEN_GT] = 4, [TOKEN_LTE] = 4, [TOKEN_GTE] = 4,
+    [TOKEN_PLUS] = 5, [TOKEN_MINUS] = 5,
+    [TOKEN_MUL] = 6, [TOKEN_DIV] = 6, [TOKEN_MOD] = 6,
+};
+
+// grammar -> logic_and ('or' logic_and)* down to
+// multiplication -> unary (('*' | '/' | '%') unary)*
+// parsed by precedence climbing, only operators binding tighter than
+// 'min_power' are consumed
+static ParseNode parser_parse_binary(Parser *self, int min_power) {
+    ParseNode node = parser_parse_unary(self);
+
+    for (;;) {
         Token token = self->current_token;
-        
-        if (token.type == TOKEN_PLUS) {
-            parser_eat(self, TOKEN_PLUS);
-        } else {
-            parser_eat(self, TOKEN_MINUS);
-        }
+        int power = binding_power[token.type];
+        if (power <= min_power) break;
 
-        node = ast_init_binop(node, parser_parse_multiplication(self), token);
-    }
-
-    return node;
-}
-
-// grammar -> unary (('*' | '/') unary)*
-static AstNode *parser_parse_multiplication(Parser *self) {
-    AstNode *node = parser_parse_unary(self);
-    
-    while (self->current_token.type == TOKEN_MUL ||
-           self->current_token.type == TOKEN_DIV ||
-           self->current_token.type == TOKEN_MOD) {
-        Token token = self->current_token;
-        
-        if (token.type == TOKEN_MUL) {
-            parser_eat(self, TOKEN_MUL);
-        } else if (token.type == TOKEN_DIV){
-            parser_eat(self, TOKEN_DIV);
-        } else {
-            parser_eat(self, TOKEN_MOD);
-        }
-
-        node = ast_init_binop(node, parser_parse_unary(self), token);
+        parser_eat(self, token.type);
+        node = parser_emit_binop(
+            self, node, parser_parse_binary(self, power), token);
     }
 
     return node;
 }
 
 // grammar -> ('!' | '-') unary | call
-static AstNode *parser_parse_unary(Parser *self) {
-    AstNode *node;
+static ParseNode parser_parse_unary(Parser *self) {
+    ParseNode node;
     
     Token token = self->current_token;
     switch (token.type) {
         case TOKEN_BANG:
             parser_eat(self, TOKEN_BANG);
-            node = ast_init_unop(parser_parse_unary(self), token);
+            node = parser_emit_unop(self, parser_parse_unary(self), token);
             break;
         case TOKEN_MINUS:
             parser_eat(self, TOKEN_MINUS);
-            node = ast_init_unop(parser_parse_unary(self), token);
+            node = parser_emit_unop(self, parser_parse_unary(self), token);
             break;
         default:
             node = parser_parse_call(self);
@@ -290,19 +479,17 @@ static AstNode *parser_parse_unary(Parser *self) {
 }
 
 // grammar -> primary ('('args?')')*
-static AstNode *parser_parse_call(Parser *self) {
-    AstNode *node;
+static ParseNode parser_parse_call(Parser *self) {
+    ParseNode node;
     node = parser_parse_primary(self);
 
     if (self->current_token.type == TOKEN_LPAREN) {
         parser_eat(self, TOKEN_LPAREN);
 
-        int arg_count = 0;
-        AstNode **args = malloc(sizeof(struct AstNode *));
+        int start = self->stack_count;
 
         while (self->current_token.type != TOKEN_RPAREN) {
-            args[arg_count] = parser_parse_expr(self);
-            arg_count++;
+            parser_push(self, parser_parse_expr(self));
 
             if (self->current_token.type == TOKEN_COMMA) {
                 parser_eat(self, TOKEN_COMMA);
@@ -310,31 +497,37 @@ static AstNode *parser_parse_call(Parser *self) {
         }
 
         parser_eat(self, TOKEN_RPAREN);
-        node = ast_init_fncall(node->value.ident_name, args, arg_count, node);
+        int arg_count = self->stack_count - start;
+        ParseNode args = parser_pop_list(self, start);
+
+        node = parser_emit_fncall(self, node, args, arg_count);
     }
     
     return node;
 }
 
-// number | string | ident | true | false | nil | '('expression')'
-static AstNode *parser_parse_primary(Parser *self) {
-    AstNode *node;
+// number | integer | string | ident | true | false | nil | '('expression')'
+static ParseNode parser_parse_primary(Parser *self) {
+    ParseNode node;
     Token token = self->current_token;
-    double number;
 
     switch (token.type) {
         case TOKEN_NUMBER:
             parser_eat(self, TOKEN_NUMBER);
-            sscanf(token.value, "%lf", &number);
-            node = ast_init_num(number);
+            node = parser_emit_num(self, &token);
+            break;
+        case TOKEN_INTEGER:
+            parser_eat(self, TOKEN_INTEGER);
+            node = parser_emit_int(self, &token);
             break;
         case TOKEN_STRING:
             parser_eat(self, TOKEN_STRING);
-            node = ast_init_str(token.value);
+            node = parser_emit_str(
+                self, lexer_token_text(self->lexer, &token), token.length);
             break;
         case TOKEN_IDENT:
             parser_eat(self, TOKEN_IDENT);
-            node = ast_init_var(token.value, token);
+            node = parser_emit_var(self, token);
             break;
         case TOKEN_LPAREN:
             parser_eat(self, TOKEN_LPAREN);
@@ -343,23 +536,23 @@ static AstNode *parser_parse_primary(Parser *self) {
             break;
         case TOKEN_TRUE:
             parser_eat(self, TOKEN_TRUE);
-            node = ast_init_bool(1);
+            node = parser_emit_bool(self, 1);
             break;
         case TOKEN_FALSE:
             parser_eat(self, TOKEN_FALSE);
-            node = ast_init_bool(0);
+            node = parser_emit_bool(self, 0);
             break;
         case TOKEN_NIL:
             parser_eat(self, TOKEN_NIL);
-            node = ast_init_nil();
+            node = parser_emit_nil(self);
             break;
         case TOKEN_EOF:
             parser_eat(self, TOKEN_EOF);
-            node = ast_init_noop();
+            node = parser_emit_noop(self);
             break;
         default:
             printf("unexpected token ");
-            print_tokens(&self->current_token);
+            print_tokens(self->lexer, &self->current_token);
             exit(1);
     }
 
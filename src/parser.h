@@ -3,16 +3,55 @@
 
 #include "lexer.h"
 #include "ast.h"
+#include "ast_flat.h"
 
-// parser structure
+// a parsed node, a tree node, a list of them, or a node or list of the
+// flat ast when the parser emits one
+typedef union ParseNode {
+    AstNode *node;
+    AstNode **list;
+    FlatRef ref;
+} ParseNode;
+
+// parser structure. the tree is allocated from the parser's arena, or
+// appended to 'flat' while emitting a flat ast. lists of forms, params
+// and args are collected on a stack first
 typedef struct Parser {
     Lexer *lexer;
     Token current_token;
+    Arena *arena;
+    AstFlat *flat;
+    ParseNode *stack;
+    int stack_count;
+    int stack_capacity;
+    // when set, fn bodies are only checked and parsed on first call.
+    // nothing is built while checking
+    int lazy;
+    int checking;
+    long lazy_count;
+    long lazy_parsed;
 } Parser;
 
+// where a lazily parsed fn body starts. the source must stay loaded
+// until the body has been parsed. scope is where the resolver left off,
+// to resolve the body in once it is parsed
+struct LazyBody {
+    struct Parser *parser;
+    Token start;
+    struct Scope *scope;
+};
+
 // init new parser
 Parser parser_init(Lexer *lexer);
 // parse tokens into abstract syntax tree
 AstNode **parser_parse_prog(Parser *self, int *child_count);
+// parse tokens into a flat ast, freed with ast_flat_destroy
+AstFlat *parser_parse_flat(Parser *self, int *child_count);
+// parse the next top level form, NULL at eof
+AstNode *parser_parse_toplevel(Parser *self);
+// parse the body of a lazily parsed fn
+void parser_parse_body(AstNode *fn);
+// release every tree the parser built
+void parser_free(Parser *self);
 
 #endif
@@ -0,0 +1,347 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "resolver.h"
+#include "parser.h"
+#include "intern.h"
+
+static void resolver_resolve_node(
+    Resolver *self, Scope *scope, AstNode *node);
+
+Resolver resolver_init(Env *globals, Arena *arena) {
+    Resolver resolver;
+
+    resolver.globals = globals;
+    resolver.arena = arena;
+    resolver.declared = intern_table_init();
+    resolver.open = 0;
+    resolver.fn_depth = 0;
+    resolver.errors = 0;
+    resolver.optimizer = NULL;
+
+    return resolver;
+}
+
+void resolver_free(Resolver *self) {
+    intern_table_free(&self->declared);
+}
+
+static int resolver_is_declared(Resolver *self, char *name) {
+    return intern_table_find(&self->declared, name) >= 0;
+}
+
+// add a name to the set of top level names
+static void resolver_declare(Resolver *self, char *name) {
+    if (resolver_is_declared(self, name)) return;
+    intern_table_add(&self->declared, name, self->declared.count);
+}
+
+// a variable resolved to a slot of a block
+struct ScopeUse {
+    AstNode *var;
+    struct ScopeUse *next;
+};
+
+// where a name is: slot 'slot' of the frame 'depth' parents up. 'block'
+// is the scope of that frame when it's a block's
+typedef struct Address {
+    int depth;
+    int slot;
+    int cell;
+    Scope *block;
+} Address;
+
+// create a scope with room for 'capacity' names, of 'fn' or of a block
+static Scope *resolver_scope(
+    Resolver *self, Scope *parent, int capacity, AstNode *fn) {
+    Scope *scope = arena_alloc(self->arena, sizeof(struct Scope));
+
+    scope->names = arena_alloc(self->arena, capacity * sizeof(char *));
+    scope->count = 0;
+    scope->visible = 0;
+    scope->parent = parent;
+    scope->resolver = self;
+    scope->fn = fn;
+    scope->captured = NULL;
+    scope->capture_capacity = 0;
+    scope->cells = NULL;
+    scope->uses = NULL;
+
+    if (fn != NULL) {
+        fn->fn.captures = NULL;
+        fn->fn.capture_count = 0;
+    } else {
+        scope->cells = arena_alloc(self->arena, capacity * sizeof(int));
+        for (int i = 0; i < capacity; i++) scope->cells[i] = 0;
+    }
+
+    return scope;
+}
+
+// slot of a name in a single scope, -1 if the scope doesn't bind it.
+// searched from the end, so of repeated params the last one wins
+static int resolver_find_slot(Scope *scope, char *name) {
+    for (int i = scope->count - 1; i >= 0; i--) {
+        if (scope->names[i] == name) return i;
+    }
+    return -1;
+}
+
+static int resolver_capture(Scope *scope, char *name);
+
+// find the address of a name from 'scope', 0 if it's global. a name from
+// outside the fn that 'scope' is in is one of the fn's captures, in the
+// frame of its closure, which is the parent of the fn's frame. a let is
+// seen by the code after it, or by all of a fn it's captured for, so the
+// fns of a block can call each other
+static int resolver_lookup(
+    Scope *scope, char *name, int captured, Address *address) {
+    for (int depth = 0; scope != NULL; scope = scope->parent, depth++) {
+        int slot = resolver_find_slot(scope, name);
+        if (slot >= 0 && (captured || slot < scope->visible)) {
+            address->depth = depth;
+            address->slot = slot;
+            address->cell = 0;
+            address->block = scope->fn == NULL ? scope : NULL;
+            return 1;
+        }
+
+        if (scope->fn != NULL) {
+            int index = resolver_capture(scope, name);
+            if (index < 0) return 0;
+
+            address->depth = depth + 1;
+            address->slot = index;
+            address->cell = scope->fn->fn.captures[index].cell;
+            address->block = NULL;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// index of a name in the captures of the fn of 'scope', which captures
+// it if it doesn't yet. -1 if the name is global. the captured variables
+// of a block live in cells, so whoever else binds or uses them sees the
+// same variable
+static int resolver_capture(Scope *scope, char *name) {
+    AstNode *fn = scope->fn;
+    Address source;
+
+    for (int i = 0; i < fn->fn.capture_count; i++) {
+        if (scope->captured[i] == name) return i;
+    }
+    if (!resolver_lookup(scope->parent, name, 1, &source)) return -1;
+
+    if (source.block != NULL) {
+        source.block->cells[source.slot] = 1;
+        source.cell = 1;
+    }
+
+    int count = fn->fn.capture_count;
+    if (count == scope->capture_capacity) {
+        Arena *arena = scope->resolver->arena;
+        Capture *captures = fn->fn.captures;
+        char **captured = scope->captured;
+
+        scope->capture_capacity = count * 2 + 4;
+        fn->fn.captures = arena_alloc(
+            arena, scope->capture_capacity * sizeof(struct Capture));
+        scope->captured = arena_alloc(
+            arena, scope->capture_capacity * sizeof(char *));
+        for (int i = 0; i < count; i++) {
+            fn->fn.captures[i] = captures[i];
+            scope->captured[i] = captured[i];
+        }
+    }
+
+    fn->fn.captures[count].depth = source.depth;
+    fn->fn.captures[count].slot = source.slot;
+    fn->fn.captures[count].cell = source.cell;
+    scope->captured[count] = name;
+    fn->fn.capture_count++;
+    return count;
+}
+
+// a variable resolved to a slot of a block is told if the slot is a cell
+// once all of the block is resolved
+static void resolver_use(Scope *block, AstNode *var) {
+    struct ScopeUse *use = arena_alloc(
+        block->resolver->arena, sizeof(struct ScopeUse));
+
+    use->var = var;
+    use->next = block->uses;
+    block->uses = use;
+}
+
+// set the address of a variable. 'what' names it in the error message
+static void resolver_resolve_var(
+    Resolver *self, Scope *scope, AstNode *node, char *what) {
+    char *name = node->var.name;
+    Address address;
+
+    if (resolver_lookup(scope, name, 0, &address)) {
+        node->var.depth = address.depth;
+        node->var.slot = address.slot;
+        node->var.cell = address.cell;
+        if (address.block != NULL) resolver_use(address.block, node);
+        return;
+    }
+
+    node->var.depth = VAR_GLOBAL;
+    if (resolver_is_declared(self, name)) return;
+    if (env_check_var(self->globals, name)) return;
+    if (self->open && self->fn_depth > 0) return;
+
+    printf("%s \"%s\" is not defined on line %d\n", what, name, node->line);
+    self->errors++;
+}
+
+// every let of a block binds a slot of the block's frame. the slots are
+// taken up front, a let becomes visible once its value is resolved
+static void resolver_resolve_block(
+    Resolver *self, Scope *scope, AstNode *node) {
+    Scope *block = resolver_scope(
+        self, scope, node->block.child_count, NULL);
+
+    for (int i = 0; i < node->block.child_count; i++) {
+        AstNode *child = node->block.children[i];
+        if (child->type != AST_ASSIGNMENT) continue;
+
+        char *name = child->assign.left->var.name;
+        if (resolver_find_slot(block, name) < 0) {
+            block->names[block->count++] = name;
+        }
+    }
+
+    node->block.slot_count = block->count;
+    for (int i = 0; i < node->block.child_count; i++) {
+        AstNode *child = node->block.children[i];
+        resolver_resolve_node(self, block, child);
+
+        if (child->type != AST_ASSIGNMENT) continue;
+        int slot = child->assign.left->var.slot;
+        if (slot >= block->visible) block->visible = slot + 1;
+    }
+
+    for (struct ScopeUse *use = block->uses; use; use = use->next) {
+        use->var->var.cell = block->cells[use->var->var.slot];
+    }
+}
+
+// parse the body of a lazily parsed fn, optimized like the rest of the
+// program was
+static void resolver_parse(Resolver *self, AstNode *fn) {
+    parser_parse_body(fn);
+    if (self->optimizer != NULL) {
+        fn->fn.body = optimizer_optimize_node(self->optimizer, fn->fn.body);
+    }
+}
+
+// params bind the slots of a fn's frame. a lazily parsed body keeps the
+// scope until it is parsed. that's only done for fns at the top level,
+// what a fn inside a fn or block captures has to be known before its
+// closure is made
+static void resolver_resolve_fn(Resolver *self, Scope *scope, AstNode *node) {
+    Scope *frame = resolver_scope(self, scope, node->fn.param_count, node);
+
+    for (int i = 0; i < node->fn.param_count; i++) {
+        frame->names[frame->count++] = node->fn.params[i]->var.name;
+    }
+    frame->visible = frame->count;
+
+    if (node->fn.lazy != NULL && scope == NULL) {
+        node->fn.lazy->scope = frame;
+        return;
+    }
+    if (node->fn.lazy != NULL) resolver_parse(self, node);
+
+    self->fn_depth++;
+    resolver_resolve_node(self, frame, node->fn.body);
+    self->fn_depth--;
+}
+
+static void resolver_resolve_assignment(
+    Resolver *self, Scope *scope, AstNode *node) {
+    AstNode *left = node->assign.left;
+
+    if (scope == NULL) {
+        left->var.depth = VAR_GLOBAL;
+    } else {
+        left->var.depth = 0;
+        left->var.slot = resolver_find_slot(scope, left->var.name);
+        left->var.cell = 0;
+        if (scope->fn == NULL) resolver_use(scope, left);
+    }
+
+    resolver_resolve_node(self, scope, node->assign.right);
+}
+
+static void resolver_resolve_node(
+    Resolver *self, Scope *scope, AstNode *node) {
+    switch (node->type) {
+        case AST_VAR:
+            resolver_resolve_var(self, scope, node, "name");
+            break;
+        case AST_UNOP:
+            resolver_resolve_node(self, scope, node->unop.right);
+            break;
+        case AST_BINOP:
+            resolver_resolve_node(self, scope, node->binop.left);
+            resolver_resolve_node(self, scope, node->binop.right);
+            break;
+        case AST_IF:
+            resolver_resolve_node(self, scope, node->if_expr.condition);
+            resolver_resolve_node(self, scope, node->if_expr.then_branch);
+            resolver_resolve_node(self, scope, node->if_expr.else_branch);
+            break;
+        case AST_ASSIGNMENT:
+            resolver_resolve_assignment(self, scope, node);
+            break;
+        case AST_BLOCK:
+            resolver_resolve_block(self, scope, node);
+            break;
+        case AST_FN:
+            resolver_resolve_fn(self, scope, node);
+            break;
+        case AST_FNCALL:
+            if (node->fncall.lambda->type == AST_VAR) {
+                resolver_resolve_var(self, scope, node->fncall.lambda, "func");
+            } else {
+                resolver_resolve_node(self, scope, node->fncall.lambda);
+            }
+            for (int i = 0; i < node->fncall.arg_count; i++) {
+                resolver_resolve_node(self, scope, node->fncall.args[i]);
+            }
+            break;
+    }
+}
+
+int resolver_resolve_prog(Resolver *self, AstNode **root, int child_count) {
+    int errors = self->errors;
+
+    for (int i = 0; i < child_count; i++) {
+        if (root[i]->type == AST_ASSIGNMENT) {
+            resolver_declare(self, root[i]->assign.left->var.name);
+        }
+    }
+
+    for (int i = 0; i < child_count; i++) {
+        resolver_resolve_node(self, NULL, root[i]);
+    }
+
+    return self->errors - errors;
+}
+
+void resolver_parse_body(AstNode *fn) {
+    Scope *scope = fn->fn.lazy->scope;
+    Resolver *self = scope->resolver;
+    int errors = self->errors;
+
+    resolver_parse(self, fn);
+
+    self->fn_depth++;
+    resolver_resolve_node(self, scope, fn->fn.body);
+    self->fn_depth--;
+
+    if (self->errors > errors) exit(1);
+}
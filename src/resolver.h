@@ -0,0 +1,58 @@
+#ifndef RESOLVER_H
+#define RESOLVER_H
+
+#include "ast.h"
+#include "env.h"
+#include "intern.h"
+#include "optimizer.h"
+
+// names bound by one runtime frame, a fn's params or the lets of a
+// block. the slot of a name is its index. code run directly in a block
+// sees the first 'visible' names, the lets it has passed. 'fn' is the fn
+// node of a fn's scope and NULL for a block's
+typedef struct Scope {
+    char **names;
+    int count;
+    int visible;
+    struct Scope *parent;
+    struct Resolver *resolver;
+    AstNode *fn;
+    // of a fn, the names of its captures in their order
+    char **captured;
+    int capture_capacity;
+    // of a block, flags of the slots closures capture and the variables
+    // resolved to its slots, which are told once the block is done
+    int *cells;
+    struct ScopeUse *uses;
+} Scope;
+
+// resolver structure. it gives every variable its lexical address before
+// the program runs, and reports the names that are bound nowhere.
+// scopes are allocated from 'arena', which has to live as long as fns
+// whose bodies are still to be parsed
+typedef struct Resolver {
+    Env *globals;
+    Arena *arena;
+    // names bound by top level lets, in the order they're first bound
+    SymbolTable declared;
+    // set when the program arrives form by form. names free in fn bodies
+    // can then be bound by a later form, and are only checked when used
+    int open;
+    int fn_depth;
+    int errors;
+    // when set, bodies of lazily parsed fns are optimized once parsed
+    Optimizer *optimizer;
+} Resolver;
+
+// init new resolver, names already bound in 'globals' are known
+Resolver resolver_init(Env *globals, Arena *arena);
+// resolve the top level forms of a program, every top level let is
+// visible in all of them. returns the number of unbound names reported
+int resolver_resolve_prog(Resolver *self, AstNode **root, int child_count);
+// parse the body of a lazily parsed fn and resolve it, exits when it
+// uses unbound names
+void resolver_parse_body(AstNode *fn);
+// free the resolver, scopes stay in the arena
+void resolver_free(Resolver *self);
+
+#endif
@@ -0,0 +1,261 @@
+#include <stdlib.h>
+#include <string.h>
+#include "scan.h"
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#define SCAN_X86
+#endif
+
+// scalar kernels, used on cpus without sse2
+
+static int scan_is_space(char c) {
+    return c == ' ' || (unsigned char)(c - '\t') <= '\r' - '\t';
+}
+
+static int scan_is_ident(char c) {
+    return (unsigned char)((c | 0x20) - 'a') <= 'z' - 'a' ||
+           (unsigned char)(c - '0') <= 9 || c == '_';
+}
+
+static const char *scalar_whitespace(const char *p, int *lines) {
+    while (scan_is_space(*p)) {
+        if (*p == '\n') (*lines)++;
+        p++;
+    }
+    return p;
+}
+
+static const char *scalar_line(const char *p) {
+    while (*p != '\n' && *p != '\0') p++;
+    return p;
+}
+
+static const char *scalar_ident(const char *p) {
+    while (scan_is_ident(*p)) p++;
+    return p;
+}
+
+static const char *scalar_string(const char *p, int *lines) {
+    while (*p != '\"' && *p != '\0') {
+        if (*p == '\n') (*lines)++;
+        p++;
+    }
+    return p;
+}
+
+static const ScanKernels scalar_kernels = {
+    "scalar", scalar_whitespace, scalar_line, scalar_ident, scalar_string
+};
+
+#ifdef SCAN_X86
+
+// sse2 kernels, 16 bytes per step. a block is classified into a bitmask
+// with one bit per byte, the run ends at the first clear bit. newlines
+// in the consumed part of a block are counted with popcount
+
+// bytes of 'v' within [lo, lo + span], as an unsigned range check
+static __m128i sse2_in_range(__m128i v, char lo, char span) {
+    __m128i x = _mm_sub_epi8(v, _mm_set1_epi8(lo));
+    return _mm_cmpeq_epi8(_mm_min_epu8(x, _mm_set1_epi8(span)), x);
+}
+
+static unsigned sse2_space_mask(__m128i v) {
+    __m128i space = _mm_cmpeq_epi8(v, _mm_set1_epi8(' '));
+    __m128i ctrl = sse2_in_range(v, '\t', '\r' - '\t');
+    return _mm_movemask_epi8(_mm_or_si128(space, ctrl));
+}
+
+static unsigned sse2_ident_mask(__m128i v) {
+    __m128i lower = _mm_or_si128(v, _mm_set1_epi8(0x20));
+    __m128i alpha = sse2_in_range(lower, 'a', 'z' - 'a');
+    __m128i digit = sse2_in_range(v, '0', 9);
+    __m128i under = _mm_cmpeq_epi8(v, _mm_set1_epi8('_'));
+    return _mm_movemask_epi8(_mm_or_si128(_mm_or_si128(alpha, digit), under));
+}
+
+static unsigned sse2_byte_mask(__m128i v, char c) {
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8(c)));
+}
+
+static const char *sse2_whitespace(const char *p, int *lines) {
+    // most runs are a single space, skip the vector setup for those
+    if (!scan_is_space(*p)) return p;
+    if (!scan_is_space(p[1])) {
+        if (*p == '\n') (*lines)++;
+        return p + 1;
+    }
+
+    for (;;) {
+        __m128i v = _mm_loadu_si128((const __m128i *)p);
+        unsigned run = sse2_space_mask(v);
+        unsigned newlines = sse2_byte_mask(v, '\n');
+
+        if (run != 0xffff) {
+            int n = __builtin_ctz(~run);
+            *lines += __builtin_popcount(newlines & ((1u << n) - 1));
+            return p + n;
+        }
+
+        *lines += __builtin_popcount(newlines);
+        p += 16;
+    }
+}
+
+static const char *sse2_line(const char *p) {
+    for (;;) {
+        __m128i v = _mm_loadu_si128((const __m128i *)p);
+        unsigned stop = sse2_byte_mask(v, '\n') | sse2_byte_mask(v, '\0');
+
+        if (stop != 0) return p + __builtin_ctz(stop);
+        p += 16;
+    }
+}
+
+static const char *sse2_ident(const char *p) {
+    for (;;) {
+        __m128i v = _mm_loadu_si128((const __m128i *)p);
+        unsigned run = sse2_ident_mask(v);
+
+        if (run != 0xffff) return p + __builtin_ctz(~run);
+        p += 16;
+    }
+}
+
+static const char *sse2_string(const char *p, int *lines) {
+    for (;;) {
+        __m128i v = _mm_loadu_si128((const __m128i *)p);
+        unsigned stop = sse2_byte_mask(v, '\"') | sse2_byte_mask(v, '\0');
+        unsigned newlines = sse2_byte_mask(v, '\n');
+
+        if (stop != 0) {
+            int n = __builtin_ctz(stop);
+            *lines += __builtin_popcount(newlines & ((1u << n) - 1));
+            return p + n;
+        }
+
+        *lines += __builtin_popcount(newlines);
+        p += 16;
+    }
+}
+
+static const ScanKernels sse2_kernels = {
+    "sse2", sse2_whitespace, sse2_line, sse2_ident, sse2_string
+};
+
+// avx2 kernels, same as sse2 with 32 bytes per step. they are compiled
+// for avx2 regardless of the build flags and only picked at runtime
+#define AVX2 __attribute__((target("avx2,popcnt,bmi")))
+
+AVX2 static __m256i avx2_in_range(__m256i v, char lo, char span) {
+    __m256i x = _mm256_sub_epi8(v, _mm256_set1_epi8(lo));
+    return _mm256_cmpeq_epi8(_mm256_min_epu8(x, _mm256_set1_epi8(span)), x);
+}
+
+AVX2 static unsigned avx2_space_mask(__m256i v) {
+    __m256i space = _mm256_cmpeq_epi8(v, _mm256_set1_epi8(' '));
+    __m256i ctrl = avx2_in_range(v, '\t', '\r' - '\t');
+    return _mm256_movemask_epi8(_mm256_or_si256(space, ctrl));
+}
+
+AVX2 static unsigned avx2_ident_mask(__m256i v) {
+    __m256i lower = _mm256_or_si256(v, _mm256_set1_epi8(0x20));
+    __m256i alpha = avx2_in_range(lower, 'a', 'z' - 'a');
+    __m256i digit = avx2_in_range(v, '0', 9);
+    __m256i under = _mm256_cmpeq_epi8(v, _mm256_set1_epi8('_'));
+    return _mm256_movemask_epi8(
+        _mm256_or_si256(_mm256_or_si256(alpha, digit), under));
+}
+
+AVX2 static unsigned avx2_byte_mask(__m256i v, char c) {
+    return _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(c)));
+}
+
+// bits of 'mask' below bit 'n', n < 32
+#define AVX2_BELOW(mask, n) ((mask) & ((1u << (n)) - 1))
+
+AVX2 static const char *avx2_whitespace(const char *p, int *lines) {
+    if (!scan_is_space(*p)) return p;
+    if (!scan_is_space(p[1])) {
+        if (*p == '\n') (*lines)++;
+        return p + 1;
+    }
+
+    for (;;) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)p);
+        unsigned run = avx2_space_mask(v);
+        unsigned newlines = avx2_byte_mask(v, '\n');
+
+        if (run != 0xffffffffu) {
+            int n = __builtin_ctz(~run);
+            *lines += __builtin_popcount(AVX2_BELOW(newlines, n));
+            return p + n;
+        }
+
+        *lines += __builtin_popcount(newlines);
+        p += 32;
+    }
+}
+
+AVX2 static const char *avx2_line(const char *p) {
+    for (;;) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)p);
+        unsigned stop = avx2_byte_mask(v, '\n') | avx2_byte_mask(v, '\0');
+
+        if (stop != 0) return p + __builtin_ctz(stop);
+        p += 32;
+    }
+}
+
+AVX2 static const char *avx2_ident(const char *p) {
+    for (;;) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)p);
+        unsigned run = avx2_ident_mask(v);
+
+        if (run != 0xffffffffu) return p + __builtin_ctz(~run);
+        p += 32;
+    }
+}
+
+AVX2 static const char *avx2_string(const char *p, int *lines) {
+    for (;;) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)p);
+        unsigned stop = avx2_byte_mask(v, '\"') | avx2_byte_mask(v, '\0');
+        unsigned newlines = avx2_byte_mask(v, '\n');
+
+        if (stop != 0) {
+            int n = __builtin_ctz(stop);
+            *lines += __builtin_popcount(AVX2_BELOW(newlines, n));
+            return p + n;
+        }
+
+        *lines += __builtin_popcount(newlines);
+        p += 32;
+    }
+}
+
+static const ScanKernels avx2_kernels = {
+    "avx2", avx2_whitespace, avx2_line, avx2_ident, avx2_string
+};
+
+#endif
+
+const ScanKernels *scan_kernels(void) {
+    static const ScanKernels *kernels = NULL;
+    if (kernels != NULL) return kernels;
+
+    char *forced = getenv("SCC_SCAN");
+    kernels = &scalar_kernels;
+
+#ifdef SCAN_X86
+    __builtin_cpu_init();
+    if (forced == NULL || strcmp(forced, "avx2") == 0) {
+        kernels = __builtin_cpu_supports("avx2") ? &avx2_kernels
+                                                 : &sse2_kernels;
+    } else if (strcmp(forced, "sse2") == 0) {
+        kernels = &sse2_kernels;
+    }
+#endif
+
+    return kernels;
+}
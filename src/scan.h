@@ -0,0 +1,29 @@
+#ifndef SCAN_H
+#define SCAN_H
+
+// zero bytes that must follow the null terminator of scanned text. the
+// kernels load whole blocks and stop at the null sentinel, so they never
+// check bounds and may read up to this far past the end
+#define SCAN_PADDING 64
+
+// scanning kernels used by the lexer to skip runs of characters. each
+// kernel scans from 'p' and returns a pointer to the first character
+// outside the run, the null terminator always ends a run. kernels that
+// can cross lines add the number of newlines skipped to 'lines'
+typedef struct ScanKernels {
+    const char *name;
+    // whitespace as in isspace()
+    const char *(*whitespace)(const char *p, int *lines);
+    // comment body, stops at the newline
+    const char *(*line)(const char *p);
+    // identifier body, letters, digits and '_'
+    const char *(*ident)(const char *p);
+    // string body, stops at the closing quote
+    const char *(*string)(const char *p, int *lines);
+} ScanKernels;
+
+// pick the widest kernels the cpu supports (avx2, sse2 or scalar), the
+// choice can be forced with the SCC_SCAN environment variable
+const ScanKernels *scan_kernels(void);
+
+#endif
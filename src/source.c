@@ -0,0 +1,107 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "source.h"
+#include "scan.h"
+
+// bytes read from a stream per refill
+#define SOURCE_CHUNK (64 * 1024)
+
+Source source_open_file(char *file_location) {
+    Source source = {NULL, 0, 0, 0, -1, 0};
+    struct stat st;
+
+    int fd = open(file_location, O_RDONLY);
+    if (fd == -1 || fstat(fd, &st) == -1) {
+        puts("error reading file");
+        exit(1);
+    }
+
+    // reserve the file rounded up to whole pages plus one more page of
+    // zeros, then map the file over the start of it. the kernel zero fills
+    // the rest of the last file page, so the contents are null terminated
+    // and padded even when the size is a multiple of the page size
+    size_t page = sysconf(_SC_PAGESIZE);
+    size_t length = st.st_size;
+    size_t mapped = (length + page - 1) / page * page + page;
+
+    char *base = mmap(NULL, mapped, PROT_READ,
+                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED) {
+        puts("error mapping file");
+        exit(1);
+    }
+
+    if (length > 0 &&
+        mmap(base, length, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, 0) ==
+        MAP_FAILED) {
+        puts("error mapping file");
+        exit(1);
+    }
+    close(fd);
+
+    source.contents = base;
+    source.length = length;
+    source.capacity = length;
+    source.mapped = mapped;
+    return source;
+}
+
+Source source_open_stream(int fd) {
+    Source source = {NULL, 0, 0, SOURCE_CHUNK, fd, 0};
+
+    source.contents = calloc(source.capacity + SCAN_PADDING, 1);
+    return source;
+}
+
+Source source_from_string(char *string) {
+    Source source = {NULL, strlen(string), 0, 0, -1, 0};
+
+    source.capacity = source.length;
+    source.contents = calloc(source.capacity + SCAN_PADDING, 1);
+    memcpy(source.contents, string, source.length);
+    return source;
+}
+
+void source_refill(Source *self, size_t keep) {
+    if (self->fd == -1) return;
+
+    // drop what the lexer no longer needs, then make room for a chunk
+    size_t drop = keep - self->base;
+    memmove(self->contents, self->contents + drop, self->length - drop);
+    self->length -= drop;
+    self->base = keep;
+
+    if (self->capacity - self->length < SOURCE_CHUNK) {
+        self->capacity = self->length + SOURCE_CHUNK;
+        self->contents = realloc(
+            self->contents, self->capacity + SCAN_PADDING);
+    }
+
+    ssize_t count;
+    do {
+        count = read(self->fd, self->contents + self->length, SOURCE_CHUNK);
+    } while (count == -1 && errno == EINTR);
+
+    if (count <= 0) {
+        self->fd = -1;
+        count = 0;
+    }
+
+    self->length += count;
+    memset(self->contents + self->length, 0, SCAN_PADDING);
+}
+
+void source_close(Source *self) {
+    if (self->mapped > 0) {
+        munmap(self->contents, self->mapped);
+    } else {
+        free(self->contents);
+    }
+    self->contents = NULL;
+}
@@ -0,0 +1,34 @@
+#ifndef SOURCE_H
+#define SOURCE_H
+
+#include <stddef.h>
+
+// source buffer handed to the lexer. contents is always followed by at
+// least SCAN_PADDING zero bytes, so the lexer can stop on the null
+// sentinel instead of checking bounds. a file is memory mapped read-only,
+// a stream is read in chunks as the lexer asks for more
+typedef struct Source {
+    char *contents;
+    size_t length;
+    // stream offset of contents[0], bytes before it were already lexed
+    size_t base;
+    size_t capacity;
+    // file descriptor of an unfinished stream, -1 once it is all read
+    int fd;
+    // size of the mapping for a mapped file, 0 for heap buffers
+    size_t mapped;
+} Source;
+
+// map a whole file read-only, exits on error
+Source source_open_file(char *file_location);
+// read a stream such as stdin incrementally
+Source source_open_stream(int fd);
+// copy a string into a padded heap buffer
+Source source_from_string(char *string);
+// read the next chunk of a stream, dropping bytes before stream offset
+// 'keep'. marks the stream finished (fd = -1) at end of input
+void source_refill(Source *self, size_t keep);
+// unmap or free the buffer
+void source_close(Source *self);
+
+#endif
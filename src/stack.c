@@ -0,0 +1,98 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <ucontext.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include "stack.h"
+
+// bytes of a segment, mapped as needed so the untouched part costs
+// nothing. the last STACK_MARGIN of it are left for whatever runs
+// between two calls: a body's nested forms, a lazy parse, a collection
+#define STACK_SEGMENT (4 * 1024 * 1024)
+#define STACK_MARGIN (256 * 1024)
+
+long stack_max_depth = 1000000;
+char *stack_limit = NULL;
+
+// a segment and the call running on it. 'spare' keeps the last one freed
+// so a recursion going back and forth over its edge doesn't remap it
+typedef struct Segment {
+    char *memory;
+    ucontext_t context;
+    ucontext_t caller;
+    char *caller_limit;
+    Value (*fn)(void *arg);
+    void *arg;
+    Value result;
+} Segment;
+
+static Segment *spare = NULL;
+// segment stack_run is about to start on
+static Segment *starting = NULL;
+
+void stack_init(void) {
+    if (stack_limit != NULL) return;
+
+    struct rlimit limit;
+    size_t size = 8 * 1024 * 1024;
+    if (getrlimit(RLIMIT_STACK, &limit) == 0 &&
+        limit.rlim_cur != RLIM_INFINITY) {
+        size = limit.rlim_cur;
+    }
+
+    // the stack also holds the environment and the frames above this
+    // one, so only half of it is counted on
+    stack_limit = (char *)__builtin_frame_address(0) - size / 2;
+}
+
+static void stack_run(void) {
+    Segment *segment = starting;
+    segment->result = segment->fn(segment->arg);
+}
+
+Value stack_call(Value (*fn)(void *arg), void *arg) {
+    // volatile as it lives across getcontext, which returns like setjmp
+    Segment *volatile segment = spare;
+
+    if (segment != NULL) {
+        spare = NULL;
+    } else {
+        segment = malloc(sizeof(struct Segment));
+        char *memory = mmap(NULL, STACK_SEGMENT, PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_STACK, -1, 0);
+        if (segment == NULL || memory == MAP_FAILED) {
+            puts("out of memory");
+            exit(1);
+        }
+        segment->memory = memory;
+    }
+
+    segment->fn = fn;
+    segment->arg = arg;
+    segment->caller_limit = stack_limit;
+    getcontext(&segment->context);
+    segment->context.uc_stack.ss_sp = segment->memory;
+    segment->context.uc_stack.ss_size = STACK_SEGMENT;
+    segment->context.uc_link = &segment->caller;
+    makecontext(&segment->context, stack_run, 0);
+
+    starting = segment;
+    stack_limit = segment->memory + STACK_MARGIN;
+    swapcontext(&segment->caller, &segment->context);
+    stack_limit = segment->caller_limit;
+
+    Value result = segment->result;
+    if (spare == NULL) {
+        spare = segment;
+    } else {
+        munmap(segment->memory, STACK_SEGMENT);
+        free(segment);
+    }
+    return result;
+}
+
+void stack_overflow(int line) {
+    printf("calls nested deeper than %ld on line %d\n",
+           stack_max_depth, line);
+    exit(1);
+}
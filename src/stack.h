@@ -0,0 +1,29 @@
+#ifndef STACK_H
+#define STACK_H
+
+#include "value.h"
+
+// how deep calls may nest and the c stack the tree walker nests them on.
+// each call the tree walker makes takes a few c frames, so it can't go
+// deep on the thread's stack alone. when that runs low, a call goes on
+// in a segment of heap memory, and another one when that runs low. the
+// vm keeps its calls in arrays it grows and needs no segments
+
+// calls may nest this deep, 0 for as deep as memory allows
+extern long stack_max_depth;
+// c stack left below this address is too little to make another call
+extern char *stack_limit;
+
+// find the end of the thread's stack, once before the first call
+void stack_init(void);
+// run 'fn' with 'arg' on a new segment and return what it returns
+Value stack_call(Value (*fn)(void *arg), void *arg);
+// report calls nested past stack_max_depth on 'line' and exit
+void stack_overflow(int line);
+
+// check if a call should go on a new segment
+static inline int stack_low(void) {
+    return (char *)__builtin_frame_address(0) < stack_limit;
+}
+
+#endif
@@ -1,15 +1,22 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <inttypes.h>
 #include <math.h>
 
+#include "source.h"
 #include "lexer.h"
 #include "parser.h"
 #include "builtin.h"
+#include "optimizer.h"
+#include "typer.h"
+#include "debug.h"
+
+// the largest int ocaml has on 64 bit, 2^62 - 1
+#define OCAML_MAX_INT 4611686018427387903
 
 // main helper funcs
 void print_help(void);
-char *readfile(char *file_location);
 void write(FILE *fp, char *code);
 
 // visitor functions
@@ -27,21 +34,85 @@ char *visitor_visit_block(AstNode *node);
 char *visitor_visit_fncall(AstNode *node);
 char *visitor_visit_fn(AstNode *node);
 
+// types of the program being transpiled, which pick ocaml's operators
+static Typer typer;
+
 int main(int argc, char *argv[]) {
-    if (argc == 2) {
-        char *contents = readfile(argv[1]);       
+    int optimize = 1;
+    int types = 1;
+    // print the optimized tree, the types or the ocaml code instead of
+    // compiling it
+    int dump = 0;
+    int dump_types = 0;
+    int print = 0;
+
+    while (argc > 2) {
+        if (strcmp(argv[1], "--no-opt") == 0) {
+            optimize = 0;
+        } else if (strcmp(argv[1], "--no-types") == 0) {
+            types = 0;
+        } else if (strcmp(argv[1], "--dump-opt") == 0) {
+            dump = 1;
+        } else if (strcmp(argv[1], "--dump-types") == 0) {
+            dump_types = 1;
+        } else if (strcmp(argv[1], "--print-ml") == 0) {
+            print = 1;
+        } else {
+            break;
+        }
+        argv++;
+        argc--;
+    }
+
+    if (argc == 2 && argv[1][0] != '-') {
+        Source source = source_open_file(argv[1]);
 
-        Lexer lexer = lexer_init(contents);
+        Lexer lexer = lexer_init(&source);
         Parser parser = parser_init(&lexer);
 
+        // parsed flat, then rebuilt as a tree for the visitors below
         int child_count = 0;
-        AstNode **root = parser_parse_prog(&parser, &child_count);
+        AstFlat *flat = parser_parse_flat(&parser, &child_count);
 
-        char *result = visitor_visit_root(root, child_count);
-        FILE *fp = fopen("intermediate.ml", "w");
+        ast_set_arena(parser.arena);
+        AstNode **root = ast_flat_to_prog(flat, &child_count);
+        ast_flat_destroy(flat);
 
-        write(fp, result);
-        system("ocamlc intermediate.ml; rm intermediate*");
+        // folds only what ocaml's ints compute the same
+        Optimizer optimizer = optimizer_init(parser.arena, 1);
+        if (optimize) {
+            child_count = optimizer_optimize_prog(
+                &optimizer, root, child_count);
+        }
+        if (dump) {
+            debug_print_ast(root, child_count);
+            optimizer_print_stats(&optimizer);
+            optimizer_free(&optimizer);
+            parser_free(&parser);
+            return 0;
+        }
+        optimizer_free(&optimizer);
+
+        // numbers are ints unless they meet a float
+        typer = typer_init(1);
+        if (types || dump_types) typer_infer_prog(&typer, root, child_count);
+        if (dump_types) {
+            typer_print_types(&typer);
+            typer_free(&typer);
+            parser_free(&parser);
+            return 0;
+        }
+
+        char *result = visitor_visit_root(root, child_count);
+        if (print) {
+            fputs(result, stdout);
+        } else {
+            FILE *fp = fopen("intermediate.ml", "w");
+            write(fp, result);
+            system("ocamlc intermediate.ml; rm intermediate*");
+        }
+        typer_free(&typer);
+        parser_free(&parser);
     } else {
         print_help();
     }
@@ -51,27 +122,13 @@ int main(int argc, char *argv[]) {
 
 void print_help(void) {
     puts("usage: ./tscc.sh [file]");
-}
-
-// read contents of file into a string
-char *readfile(char *file_location) {
-    char *contents;
-    long length = 0;
-
-    FILE *fp = fopen(file_location, "rb");
-    if (fp != NULL) {
-        fseek(fp, 0, SEEK_END);
-        length = ftell(fp);
-        fseek(fp, 0, SEEK_SET);
-
-        contents = malloc(length + 1);
-        if (contents != NULL) fread(contents, 1, length, fp); 
-        fclose(fp);
-
-        return contents;
-    }
-    puts("error reading file");
-    exit(1);
+    puts("       tscc --no-opt file    (without folding, inlining and");
+    puts("                             removing dead code)");
+    puts("       tscc --no-types file  (ints for every number and");
+    puts("                             string, + for every addition)");
+    puts("       tscc --dump-opt file  (print the optimized tree)");
+    puts("       tscc --dump-types file  (print the types inferred)");
+    puts("       tscc --print-ml file  (print the ocaml code instead)");
 }
 
 void write(FILE *fp, char *code) {
@@ -86,33 +143,54 @@ void write(FILE *fp, char *code) {
 }
 
 char *ast_to_str(AstNode *node) {
-    char *str;
+    char *str = NULL;
     switch (node->type) {
         case AST_NUMBER:
-            str = malloc(node->value.num_value / 10 + 2);
-            if (fmod(node->value.num_value, 1) == 0) {
-                sprintf(str, "%d", (int)node->value.num_value);
-            } else {
+            str = malloc(snprintf(NULL, 0, "%0.3lf", node->value.num_value) + 2);
+            // a literal with a '.' is a float, unless types are off
+            if (fmod(node->value.num_value, 1) != 0) {
                 sprintf(str, "%0.3lf", node->value.num_value);
+            } else if (typer_is_float(&typer, node)) {
+                sprintf(str, "%.0f.", node->value.num_value);
+            } else {
+                sprintf(str, "%.0f", node->value.num_value);
+            }
+            break;
+        case AST_INTEGER:
+            // ocaml's ints are 63 bits, a wider one would not compile
+            if (node->value.int_value > OCAML_MAX_INT &&
+                !typer_is_float(&typer, node)) {
+                printf("int %" PRId64 " is past ocaml's max_int\n",
+                       node->value.int_value);
+                exit(1);
             }
+            str = malloc(snprintf(NULL, 0, "%" PRId64 ".",
+                                  node->value.int_value) + 1);
+            sprintf(str, typer_is_float(&typer, node) ? "%" PRId64 "."
+                                                      : "%" PRId64,
+                    node->value.int_value);
             break;
         case AST_STRING:
             str = malloc(strlen(node->value.str_value) + 3);
             sprintf(str, "\"%s\"", node->value.str_value);
             break;
         case AST_VAR:
-            str = node->value.ident_name;
+            str = strdup(node->value.ident_name);
             break;
         // case AST_UNOP:
             // break;
+        // callers free what visitors return
         case AST_NIL:
         case AST_NOOP:
-            str = "nil";
+            str = strdup("nil");
             break;
         case AST_BOOL:
-            if (node->value.bool_value == 1) str = "true";
-            else str = "false";
+            if (node->value.bool_value == 1) str = strdup("true");
+            else str = strdup("false");
             break;
+        default:
+            printf("no literal for node type %d\n", node->type);
+            exit(1);
     }
 
     return str;
@@ -137,6 +215,7 @@ static char *visitor_visit_root(struct AstNode **root, int child_count) {
 char *visitor_visit_node(AstNode *node) {
     switch (node->type) {
         case AST_NUMBER:
+        case AST_INTEGER:
         case AST_STRING:
         case AST_BOOL:
         case AST_NIL:
@@ -157,12 +236,15 @@ char *visitor_visit_node(AstNode *node) {
             return visitor_visit_block(node);
         case AST_BINOP:
             return visitor_visit_binop(node);
+        default:
+            printf("can't transpile node type %d\n", node->type);
+            exit(1);
     }
 }
 
 char *visitor_visit_assignment(AstNode *node) {
-    char *varname = node->left->value.ident_name;
-    char *value = visitor_visit_node(node->right);
+    char *varname = node->assign.left->value.ident_name;
+    char *value = visitor_visit_node(node->assign.right);
 
     char *result = malloc(9);
     result[0] = '\0';
@@ -180,13 +262,14 @@ char *visitor_visit_assignment(AstNode *node) {
 }
 
 char *visitor_visit_var(AstNode *node) {
-    return node->value.ident_name;
+    // names are interned, callers free what visitors return
+    return strdup(node->value.ident_name);
 }
 
 char *visitor_visit_if(AstNode *node) {
-    char *cond = visitor_visit_node(node->condition);
-    char *then = visitor_visit_node(node->then_branch);
-    char *elsse = visitor_visit_node(node->else_branch);
+    char *cond = visitor_visit_node(node->if_expr.condition);
+    char *then = visitor_visit_node(node->if_expr.then_branch);
+    char *elsse = visitor_visit_node(node->if_expr.else_branch);
 
     char *result = malloc(4);
     result[0] = '\0';
@@ -207,72 +290,81 @@ char *visitor_visit_if(AstNode *node) {
     return result;
 }
 
-char *visitor_visit_binop(AstNode *node) {
-    char *left = visitor_visit_node(node->left);
-    char *right = visitor_visit_node(node->right);
+// operands that are operators or ifs themselves are parenthesized, the
+// tree already has the grouping the source had. inlined bodies land in
+// operands of any precedence
+static char *visitor_visit_operand(AstNode *node) {
+    char *code = visitor_visit_node(node);
+    if (node->type != AST_BINOP && node->type != AST_UNOP &&
+        node->type != AST_IF) {
+        return code;
+    }
 
-    char *result = malloc(strlen(left) + strlen(right) + 4);
-    result[0] = '\0';
-    strcat(result, left);
+    char *result = malloc(strlen(code) + 3);
+    sprintf(result, "(%s)", code);
+    free(code);
+    return result;
+}
+
+// ocaml operator for a binop, by the type the typer proved its operands
+// have. ints unless they're floats or strings
+static const char *visitor_operator(AstNode *node) {
+    int type = node->binop.operands;
 
-    switch (node->op.type) {
+    switch (node->binop.op) {
         case TOKEN_PLUS:
-            strcat(result, " + ");
-            break;
-        case TOKEN_MINUS:
-            strcat(result, " - ");
-            break;
-        case TOKEN_MUL:
-            strcat(result, " * ");
-            break;
-        case TOKEN_MOD:
-            strcat(result, " % ");
-            break;
-        case TOKEN_DIV:
-            strcat(result, " / ");
-            break;
-        case TOKEN_LT:
-            strcat(result, " < ");
-            break;
-        case TOKEN_GT:
-            strcat(result, " > ");
-            break;
-        case TOKEN_LTE:
-            strcat(result, " <= ");
-            break;
-        case TOKEN_GTE:
-            strcat(result, " >= ");
-            break;
-        case TOKEN_EQUAL:
-            strcat(result, " == ");
-            break;
-        case TOKEN_NEQUAL:
-            strcat(result, " != ");
-            break;
-        case TOKEN_AND:
-            strcat(result, " && ");
-            break;
-        case TOKEN_OR:
-            strcat(result, " || ");
-            break;
+            if (type == TYPE_STR) return " ^ ";
+            return type == TYPE_FLOAT ? " +. " : " + ";
+        case TOKEN_MINUS:  return type == TYPE_FLOAT ? " -. " : " - ";
+        case TOKEN_MUL:    return type == TYPE_FLOAT ? " *. " : " * ";
+        case TOKEN_DIV:    return type == TYPE_FLOAT ? " /. " : " / ";
+        case TOKEN_MOD:    return " mod ";
+        case TOKEN_LT:     return " < ";
+        case TOKEN_GT:     return " > ";
+        case TOKEN_LTE:    return " <= ";
+        case TOKEN_GTE:    return " >= ";
+        case TOKEN_EQUAL:  return " = ";
+        case TOKEN_NEQUAL: return " <> ";
+        case TOKEN_AND:    return " && ";
+        default:           return " || ";
+    }
+}
+
+char *visitor_visit_binop(AstNode *node) {
+    char *left = visitor_visit_operand(node->binop.left);
+    char *right = visitor_visit_operand(node->binop.right);
+    char *result;
+
+    // float remainder is a fn, its args are parenthesized like a call's.
+    // ints are divided as floats, as the typer made their quotient one
+    if (node->binop.op == TOKEN_MOD && node->binop.operands == TYPE_FLOAT) {
+        result = malloc(strlen(left) + strlen(right) + 16);
+        sprintf(result, "mod_float (%s) (%s)", left, right);
+    } else if (node->binop.op == TOKEN_DIV &&
+               node->binop.operands == TYPE_INT) {
+        result = malloc(strlen(left) + strlen(right) + 36);
+        sprintf(result, "float_of_int (%s) /. float_of_int (%s)", left, right);
+    } else {
+        const char *op = visitor_operator(node);
+        result = malloc(strlen(left) + strlen(op) + strlen(right) + 1);
+        sprintf(result, "%s%s%s", left, op, right);
     }
 
-    strcat(result, right);
+    free(left);
+    free(right);
     return result;
 }
 
 char *visitor_visit_unop(AstNode *node) {
-    char *right = visitor_visit_node(node->right);
-    char *result = malloc(2);
-    result[0] = '\0';
-
-    if (node->op.type == TOKEN_BANG) result[1] = '!';
-    else if (node->op.type == TOKEN_MINUS) result[1] = '-';
+    char *right = visitor_visit_operand(node->unop.right);
+    char *result = malloc(strlen(right) + 5);
 
-    result = realloc(result, strlen(result) + strlen(right) + 1);
-    strcat(result, right);
+    if (node->unop.op == TOKEN_BANG) sprintf(result, "not %s", right);
+    else if (node->unop.operand == TYPE_FLOAT) sprintf(result, "-.%s", right);
+    else sprintf(result, "-%s", right);
 
-    return result; 
+    free(right);
+    return result;
 }
 
 char *visitor_visit_block(AstNode *node) {
@@ -280,8 +372,8 @@ char *visitor_visit_block(AstNode *node) {
     result[0] = '\0';
     strcat(result, "begin ");
     
-    for (int i = 0; i < node->child_count; i++) {
-        char *temp = visitor_visit_node(node->children[i]);
+    for (int i = 0; i < node->block.child_count; i++) {
+        char *temp = visitor_visit_node(node->block.children[i]);
         result = realloc(result, strlen(result) + strlen(temp) + 2);
 
         strcat(result, temp);
@@ -299,17 +391,17 @@ char *visitor_visit_fncall(AstNode *node) {
     char *result = malloc(1);
     result[0] = '\0';
 
-    if (node->value.ident_name != NULL) {
-        strcat(result, node->value.ident_name);
+    if (node->fncall.name != NULL) {
+        strcat(result, node->fncall.name);
 
-        if (node->arg_count == 0) {
+        if (node->fncall.arg_count == 0) {
             result = realloc(result, strlen(result) + 3);
             strcat(result, "()");
             return result;
         }
 
-        for (int i = 0; i < node->arg_count; i++) {
-            char *arg = visitor_visit_node(node->args[i]);
+        for (int i = 0; i < node->fncall.arg_count; i++) {
+            char *arg = visitor_visit_node(node->fncall.args[i]);
 
             char *arg_to_cat = malloc(strlen(arg) + 3);
             sprintf(arg_to_cat, "(%s)", arg);
@@ -326,9 +418,9 @@ char *visitor_visit_fncall(AstNode *node) {
         return result;
     }
 
-    result = visitor_visit_fn(node->lambda);
+    result = visitor_visit_fn(node->fncall.lambda);
 
-    if (node->arg_count == 0) {
+    if (node->fncall.arg_count == 0) {
         result = realloc(result, strlen(result) + 3);
         strcat(result, "()");
         return result;
@@ -337,8 +429,8 @@ char *visitor_visit_fncall(AstNode *node) {
     result = realloc(result, strlen(result) + 2);
     strcat(result, " ");
 
-    for (int i = 0; i < node->arg_count; i++) {
-        char *arg = visitor_visit_node(node->args[i]);
+    for (int i = 0; i < node->fncall.arg_count; i++) {
+        char *arg = visitor_visit_node(node->fncall.args[i]);
 
         char *arg_to_cat = malloc(strlen(arg) + 3);
         sprintf(arg_to_cat, "(%s)", arg);
@@ -360,16 +452,16 @@ char *visitor_visit_fn(AstNode *node) {
     result[0] = '\0';
     strcat(result, "(fun ");
 
-    for (int i = 0; i < node->param_count; i++) {
+    for (int i = 0; i < node->fn.param_count; i++) {
         result = realloc(
             result,
-            strlen(result) + strlen(node->params[i]->value.ident_name) + 2
+            strlen(result) + strlen(node->fn.params[i]->value.ident_name) + 2
         );
-        strcat(result, node->params[i]->value.ident_name);
+        strcat(result, node->fn.params[i]->value.ident_name);
         strcat(result, " ");
     }
     
-    char *body = visitor_visit_node(node->body);
+    char *body = visitor_visit_node(node->fn.body);
     result = realloc(result, strlen(result) + strlen(body) + strlen("-> ") + 2);
 
     strcat(result, "-> ");
@@ -0,0 +1,724 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include "typer.h"
+#include "lexer.h"
+#include "intern.h"
+
+// level of the vars of a polymorphic type, which are copied for each
+// read of it
+#define TYPER_GENERIC INT_MAX
+
+Typer typer_init(int integral) {
+    Typer typer;
+
+    typer.arena = arena_create();
+    typer.integral = integral;
+    typer.level = 0;
+    typer.globals = NULL;
+    typer.global_count = 0;
+    typer.global_capacity = 0;
+    typer.names = intern_table_init();
+    typer.locals = NULL;
+    typer.local_count = 0;
+    typer.local_capacity = 0;
+    typer.scopes = 0;
+    typer.fn_mark = 0;
+    typer.copies = NULL;
+    typer.copy_count = 0;
+    typer.copy_capacity = 0;
+    typer.puts = intern_string("puts");
+    typer.gets = intern_string("gets");
+    typer.nodes = NULL;
+    typer.types = NULL;
+    typer.node_count = 0;
+    typer.node_capacity = 0;
+    typer.floats = NULL;
+    typer.float_capacity = 0;
+    typer.operators = 0;
+    typer.specialised = 0;
+
+    return typer;
+}
+
+void typer_free(Typer *self) {
+    arena_destroy(self->arena);
+    free(self->globals);
+    intern_table_free(&self->names);
+    free(self->locals);
+    free(self->copies);
+    free(self->nodes);
+    free(self->types);
+    free(self->floats);
+}
+
+static Type *typer_new(Typer *self, int kind) {
+    Type *type = arena_alloc(self->arena, sizeof(struct Type));
+
+    type->kind = kind;
+    type->level = self->level;
+    type->numeric = 0;
+    type->link = NULL;
+    type->params = NULL;
+    type->param_count = 0;
+
+    return type;
+}
+
+// fn type of 'param_count' params, which the caller fills in, and the
+// result after them
+static Type *typer_fn(Typer *self, int param_count) {
+    Type *type = typer_new(self, TYPE_FN);
+
+    type->params = arena_alloc(
+        self->arena, (param_count + 1) * sizeof(struct Type *));
+    type->param_count = param_count;
+
+    return type;
+}
+
+// type a number is: an int or a double, or in ocaml an int unless it's
+// unified with a float
+static Type *typer_number(Typer *self) {
+    if (!self->integral) return typer_new(self, TYPE_NUM);
+
+    Type *type = typer_new(self, TYPE_VAR);
+    type->numeric = 1;
+    return type;
+}
+
+// the type a var stands for, links followed are shortened
+static Type *typer_find(Type *type) {
+    Type *root = type;
+    while (root->link != NULL) root = root->link;
+
+    while (type->link != NULL) {
+        Type *next = type->link;
+        type->link = root;
+        type = next;
+    }
+    return root;
+}
+
+// make a type TYPE_ANY. a fn that is may be called with anything and
+// return anything, so its params and result are too
+static void typer_poison(Type *type) {
+    type = typer_find(type);
+    if (type->kind == TYPE_ANY) return;
+
+    int kind = type->kind;
+    type->kind = TYPE_ANY;
+    if (kind != TYPE_FN) return;
+
+    for (int i = 0; i <= type->param_count; i++) {
+        typer_poison(type->params[i]);
+    }
+}
+
+// check if 'var' occurs in 'type', lowering the vars in it to the level
+// of 'var' on the way so they aren't generalized before it is
+static int typer_occurs(Type *var, Type *type) {
+    type = typer_find(type);
+    if (type == var) return 1;
+    if (type->kind == TYPE_VAR && type->level > var->level) {
+        type->level = var->level;
+    }
+    if (type->kind != TYPE_FN) return 0;
+
+    for (int i = 0; i <= type->param_count; i++) {
+        if (typer_occurs(var, type->params[i])) return 1;
+    }
+    return 0;
+}
+
+static int typer_is_numeric(Type *type) {
+    switch (type->kind) {
+        case TYPE_ANY:
+        case TYPE_NUM:
+        case TYPE_INT:
+        case TYPE_FLOAT:
+        case TYPE_VAR:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+static void typer_unify(Type *left, Type *right);
+
+static void typer_bind(Type *var, Type *type) {
+    if (typer_occurs(var, type) || (var->numeric && !typer_is_numeric(type))) {
+        typer_poison(var);
+        typer_poison(type);
+        return;
+    }
+
+    if (var->numeric && type->kind == TYPE_VAR) type->numeric = 1;
+    var->link = type;
+}
+
+// make two types the same. types that can't be are both poisoned, the
+// values of either may be the other's. types of the same kind are linked
+// too, so poisoning one later poisons both
+static void typer_unify(Type *left, Type *right) {
+    left = typer_find(left);
+    right = typer_find(right);
+    if (left == right) return;
+
+    if (left->kind == TYPE_VAR) {
+        typer_bind(left, right);
+    } else if (right->kind == TYPE_VAR) {
+        typer_bind(right, left);
+    } else if (left->kind != right->kind ||
+               left->param_count != right->param_count) {
+        typer_poison(left);
+        typer_poison(right);
+    } else {
+        left->link = right;
+        if (left->kind != TYPE_FN) return;
+
+        for (int i = 0; i <= left->param_count; i++) {
+            typer_unify(left->params[i], right->params[i]);
+        }
+    }
+}
+
+// unify a type with one of 'kind', made only if it isn't one already.
+// TYPE_NUM stands for any number
+static void typer_expect(Typer *self, Type *type, int kind) {
+    Type *found = typer_find(type);
+
+    if (found->kind == kind) return;
+    if (kind != TYPE_NUM) {
+        typer_unify(found, typer_new(self, kind));
+    } else if (found->kind != TYPE_INT && found->kind != TYPE_FLOAT &&
+               !found->numeric) {
+        typer_unify(found, typer_number(self));
+    }
+}
+
+// mark the vars of a let's type still deeper than the let as generic
+static void typer_generalize(Typer *self, Type *type) {
+    type = typer_find(type);
+    if (type->kind == TYPE_VAR && type->level > self->level) {
+        type->level = TYPER_GENERIC;
+    }
+    if (type->kind != TYPE_FN) return;
+
+    for (int i = 0; i <= type->param_count; i++) {
+        typer_generalize(self, type->params[i]);
+    }
+}
+
+// check if a type has generic vars
+static int typer_is_generic(Type *type) {
+    type = typer_find(type);
+    if (type->kind == TYPE_VAR) return type->level == TYPER_GENERIC;
+    if (type->kind != TYPE_FN) return 0;
+
+    for (int i = 0; i <= type->param_count; i++) {
+        if (typer_is_generic(type->params[i])) return 1;
+    }
+    return 0;
+}
+
+// copy of a polymorphic type with fresh vars for its generalized ones.
+// the rest is shared, so poisoning a copy poisons what the fn's body
+// was typed with
+static Type *typer_copy(Typer *self, Type *type) {
+    type = typer_find(type);
+
+    if (type->kind == TYPE_VAR) {
+        if (type->level != TYPER_GENERIC) return type;
+        for (int i = 0; i < self->copy_count; i += 2) {
+            if (self->copies[i] == type) return self->copies[i + 1];
+        }
+
+        if (self->copy_count + 2 > self->copy_capacity) {
+            self->copy_capacity = self->copy_capacity * 2 + 16;
+            self->copies = realloc(
+                self->copies, self->copy_capacity * sizeof(struct Type *));
+        }
+        Type *copy = typer_new(self, TYPE_VAR);
+        copy->numeric = type->numeric;
+        self->copies[self->copy_count++] = type;
+        self->copies[self->copy_count++] = copy;
+        return copy;
+    }
+    if (type->kind != TYPE_FN || !typer_is_generic(type)) return type;
+
+    Type *copy = typer_fn(self, type->param_count);
+    for (int i = 0; i <= type->param_count; i++) {
+        copy->params[i] = typer_copy(self, type->params[i]);
+    }
+    return copy;
+}
+
+// the global top level lets bind to 'name', NULL if none does
+static Global *typer_find_global(Typer *self, char *name) {
+    long index = intern_table_find(&self->names, name);
+    return index < 0 ? NULL : &self->globals[index];
+}
+
+// count a top level let of 'name', adding it the first time
+static void typer_declare(Typer *self, char *name) {
+    Global *global = typer_find_global(self, name);
+    if (global != NULL) {
+        global->bindings++;
+        return;
+    }
+
+    if (self->global_count == self->global_capacity) {
+        self->global_capacity = self->global_capacity * 2 + 16;
+        self->globals = realloc(
+            self->globals, self->global_capacity * sizeof(struct Global));
+    }
+
+    global = &self->globals[self->global_count];
+    global->name = name;
+    global->type = typer_new(self, TYPE_VAR);
+    global->bindings = 1;
+    global->bound = 0;
+    global->used = 0;
+    global->generic = 0;
+    intern_table_add(&self->names, name, self->global_count++);
+}
+
+// count the lets of a top level form that bind globals, which are those
+// outside of any block or fn
+static void typer_count(Typer *self, AstNode *node) {
+    switch (node->type) {
+        case AST_ASSIGNMENT:
+            typer_declare(self, node->assign.left->var.name);
+            typer_count(self, node->assign.right);
+            break;
+        case AST_UNOP:
+            typer_count(self, node->unop.right);
+            break;
+        case AST_BINOP:
+            typer_count(self, node->binop.left);
+            typer_count(self, node->binop.right);
+            break;
+        case AST_IF:
+            typer_count(self, node->if_expr.condition);
+            typer_count(self, node->if_expr.then_branch);
+            typer_count(self, node->if_expr.else_branch);
+            break;
+        case AST_FNCALL:
+            typer_count(self, node->fncall.lambda);
+            for (int i = 0; i < node->fncall.arg_count; i++) {
+                typer_count(self, node->fncall.args[i]);
+            }
+            break;
+    }
+}
+
+static void typer_push_local(Typer *self, char *name, Type *type) {
+    if (self->local_count == self->local_capacity) {
+        self->local_capacity = self->local_capacity * 2 + 16;
+        self->locals = realloc(
+            self->locals, self->local_capacity * sizeof(struct Local));
+    }
+    self->locals[self->local_count].name = name;
+    self->locals[self->local_count].type = type;
+    self->locals[self->local_count].visible = 1;
+    self->local_count++;
+}
+
+// the innermost block let or param named 'name' in scope, NULL if none
+// is. 'from' is the first local to look at, 'all' counts block lets not
+// yet visible
+static Local *typer_find_local(Typer *self, char *name, int from, int all) {
+    for (int i = self->local_count - 1; i >= from; i--) {
+        Local *local = &self->locals[i];
+        if (local->name != name) continue;
+        if (all || local->visible || i < self->fn_mark) return local;
+    }
+    return NULL;
+}
+
+// check if 'name' is a builtin where it's read. a top level let of it
+// makes it one until the let runs and the fn bound after
+static int typer_is_builtin(Typer *self, char *name) {
+    return (name == self->puts || name == self->gets) &&
+           typer_find_local(self, name, 0, 0) == NULL &&
+           typer_find_global(self, name) == NULL;
+}
+
+// type of a variable where it's read
+static Type *typer_lookup(Typer *self, char *name) {
+    Local *local = typer_find_local(self, name, 0, 0);
+    if (local != NULL) return local->type;
+
+    Global *global = typer_find_global(self, name);
+    if (global == NULL || name == self->puts || name == self->gets) {
+        return typer_new(self, TYPE_ANY);
+    }
+
+    if (global->generic) {
+        self->copy_count = 0;
+        return typer_copy(self, global->type);
+    }
+    if (global->bound == 0) global->used = 1;
+    return global->type;
+}
+
+// remember the operand types of an operator, or the type of a literal
+static void typer_record(Typer *self, AstNode *node, Type *left, Type *right) {
+    if (self->node_count == self->node_capacity) {
+        self->node_capacity = self->node_capacity * 2 + 64;
+        self->nodes = realloc(
+            self->nodes, self->node_capacity * sizeof(struct AstNode *));
+        self->types = realloc(
+            self->types, self->node_capacity * 2 * sizeof(struct Type *));
+    }
+    self->nodes[self->node_count] = node;
+    self->types[self->node_count * 2] = left;
+    self->types[self->node_count * 2 + 1] = right;
+    self->node_count++;
+}
+
+static Type *typer_infer(Typer *self, AstNode *node);
+
+// a let of a global that no form read before it and no other let binds
+// is generalized: its type is made a level deeper, and vars still that
+// deep afterwards are copied each time the name is read
+static Type *typer_infer_let(Typer *self, AstNode *node) {
+    char *name = node->assign.left->var.name;
+
+    if (self->scopes > 0) {
+        Type *value = typer_infer(self, node->assign.right);
+        Local *local = typer_find_local(self, name, 0, 1);
+        if (local != NULL) {
+            typer_unify(local->type, value);
+            local->visible = 1;
+        }
+        return typer_new(self, TYPE_UNIT);
+    }
+
+    Global *global = typer_find_global(self, name);
+    global->bound++;
+
+    if (name == self->puts || name == self->gets) {
+        typer_poison(typer_infer(self, node->assign.right));
+    } else if (global->bindings == 1 && !global->used) {
+        self->level++;
+        global->type = typer_new(self, TYPE_VAR);
+        typer_unify(global->type, typer_infer(self, node->assign.right));
+        self->level--;
+        typer_generalize(self, global->type);
+        global->generic = 1;
+    } else {
+        typer_unify(global->type, typer_infer(self, node->assign.right));
+    }
+    return typer_new(self, TYPE_UNIT);
+}
+
+// lets of a block bind its names from its start, visible from each let
+// on and to the fns of the block before
+static Type *typer_infer_block(Typer *self, AstNode *node) {
+    int mark = self->local_count;
+    Type *type = typer_new(self, TYPE_UNIT);
+
+    self->scopes++;
+    for (int i = 0; i < node->block.child_count; i++) {
+        AstNode *child = node->block.children[i];
+        if (child->type != AST_ASSIGNMENT) continue;
+
+        char *name = child->assign.left->var.name;
+        if (typer_find_local(self, name, mark, 1) == NULL) {
+            typer_push_local(self, name, typer_new(self, TYPE_VAR));
+            self->locals[self->local_count - 1].visible = 0;
+        }
+    }
+
+    for (int i = 0; i < node->block.child_count; i++) {
+        type = typer_infer(self, node->block.children[i]);
+    }
+    self->scopes--;
+    self->local_count = mark;
+    return type;
+}
+
+// a body parsed lazily isn't seen, so neither is what it does with
+// the fn's params
+static Type *typer_infer_fn(Typer *self, AstNode *node) {
+    if (node->fn.body == NULL) return typer_new(self, TYPE_ANY);
+
+    int mark = self->local_count;
+    int fn_mark = self->fn_mark;
+    Type *type = typer_fn(self, node->fn.param_count);
+
+    self->scopes++;
+    self->fn_mark = mark;
+    for (int i = 0; i < node->fn.param_count; i++) {
+        type->params[i] = typer_new(self, TYPE_VAR);
+        typer_push_local(self, node->fn.params[i]->var.name, type->params[i]);
+    }
+    type->params[node->fn.param_count] = typer_infer(self, node->fn.body);
+    self->scopes--;
+    self->fn_mark = fn_mark;
+    self->local_count = mark;
+    return type;
+}
+
+// the callee is unified with a fn of the args' types. calling what isn't
+// known to be a fn poisons the args, it may do anything with them. the
+// builtins take anything
+static Type *typer_infer_call(Typer *self, AstNode *node) {
+    AstNode *callee = node->fncall.lambda;
+    int arg_count = node->fncall.arg_count;
+
+    if (callee->type == AST_VAR && typer_is_builtin(self, callee->var.name)) {
+        for (int i = 0; i < arg_count; i++) {
+            typer_infer(self, node->fncall.args[i]);
+        }
+        if (callee->var.name == self->gets) return typer_new(self, TYPE_STR);
+        return typer_new(self, TYPE_UNIT);
+    }
+
+    Type *type = typer_infer(self, callee);
+    Type *call = typer_fn(self, arg_count);
+    for (int i = 0; i < arg_count; i++) {
+        call->params[i] = typer_infer(self, node->fncall.args[i]);
+    }
+    call->params[arg_count] = typer_new(self, TYPE_VAR);
+    typer_unify(type, call);
+    return call->params[arg_count];
+}
+
+// the engines compute every operator on anything: arithmetic counts
+// what isn't a number as one, == compares anything. operands are only
+// unified with the type an operator takes so that a fn's params get it,
+// and == leaves its operands alone. in ocaml both operands of an
+// operator have the same type, + adds strings too
+static Type *typer_infer_binop(Typer *self, AstNode *node) {
+    Type *left = typer_infer(self, node->binop.left);
+    Type *right = typer_infer(self, node->binop.right);
+    int op = node->binop.op;
+
+    typer_record(self, node, left, right);
+
+    if (op == TOKEN_AND || op == TOKEN_OR) {
+        typer_expect(self, left, TYPE_BOOL);
+        typer_expect(self, right, TYPE_BOOL);
+        return typer_new(self, TYPE_BOOL);
+    }
+
+    int compare = op == TOKEN_LT || op == TOKEN_GT || op == TOKEN_LTE ||
+                  op == TOKEN_GTE || op == TOKEN_EQUAL || op == TOKEN_NEQUAL;
+
+    // a / is always a float, the transpiler divides ints as floats. the
+    // engines give an int only when it's exact
+    if (self->integral) {
+        typer_unify(left, right);
+        if (compare) return typer_new(self, TYPE_BOOL);
+        if (op != TOKEN_PLUS) typer_expect(self, left, TYPE_NUM);
+        if (op == TOKEN_DIV) return typer_new(self, TYPE_FLOAT);
+        return left;
+    }
+
+    if (op != TOKEN_EQUAL && op != TOKEN_NEQUAL) {
+        typer_expect(self, left, TYPE_NUM);
+        typer_expect(self, right, TYPE_NUM);
+    }
+    if (compare) return typer_new(self, TYPE_BOOL);
+    return typer_number(self);
+}
+
+static Type *typer_infer_unop(Typer *self, AstNode *node) {
+    Type *right = typer_infer(self, node->unop.right);
+
+    if (node->unop.op == TOKEN_BANG) {
+        if (self->integral) typer_expect(self, right, TYPE_BOOL);
+        return typer_new(self, TYPE_BOOL);
+    }
+
+    typer_record(self, node, right, right);
+    typer_expect(self, right, TYPE_NUM);
+    return self->integral ? right : typer_number(self);
+}
+
+// any value is a condition, in ocaml only a bool
+static Type *typer_infer_if(Typer *self, AstNode *node) {
+    Type *condition = typer_infer(self, node->if_expr.condition);
+    Type *then = typer_infer(self, node->if_expr.then_branch);
+    Type *alter = typer_infer(self, node->if_expr.else_branch);
+
+    if (self->integral) typer_expect(self, condition, TYPE_BOOL);
+    typer_unify(then, alter);
+    return then;
+}
+
+static Type *typer_infer(Typer *self, AstNode *node) {
+    switch (node->type) {
+        case AST_NUMBER:
+        case AST_INTEGER: {
+            // in ocaml a literal with a '.' is a float, 2.0 too
+            if (!self->integral) return typer_number(self);
+
+            Type *type = node->type == AST_NUMBER
+                ? typer_new(self, TYPE_FLOAT) : typer_number(self);
+            typer_record(self, node, type, type);
+            return type;
+        }
+        case AST_STRING:
+            return typer_new(self, TYPE_STR);
+        case AST_BOOL:
+            return typer_new(self, TYPE_BOOL);
+        case AST_NIL:
+            return typer_new(self, TYPE_NIL);
+        case AST_VAR:
+            return typer_lookup(self, node->var.name);
+        case AST_BINOP:
+            return typer_infer_binop(self, node);
+        case AST_UNOP:
+            return typer_infer_unop(self, node);
+        case AST_IF:
+            return typer_infer_if(self, node);
+        case AST_ASSIGNMENT:
+            return typer_infer_let(self, node);
+        case AST_BLOCK:
+            return typer_infer_block(self, node);
+        case AST_FN:
+            return typer_infer_fn(self, node);
+        case AST_FNCALL:
+            return typer_infer_call(self, node);
+        default:
+            return typer_new(self, TYPE_UNIT);
+    }
+}
+
+// what a type is once every form is typed. a number var nothing made a
+// float is an int, other vars may be anything
+static int typer_kind(Type *type) {
+    type = typer_find(type);
+    if (type->kind != TYPE_VAR) return type->kind;
+    return type->numeric ? TYPE_INT : TYPE_ANY;
+}
+
+static long typer_hash(void *key, long capacity) {
+    return INTERN_SYMBOL_HASH(key) & (capacity - 1);
+}
+
+static void typer_add_float(Typer *self, AstNode *literal) {
+    long slot = typer_hash(literal, self->float_capacity);
+    while (self->floats[slot] != NULL) {
+        slot = (slot + 1) & (self->float_capacity - 1);
+    }
+    self->floats[slot] = literal;
+}
+
+int typer_is_float(Typer *self, AstNode *literal) {
+    if (self->float_capacity == 0) return 0;
+
+    long slot = typer_hash(literal, self->float_capacity);
+    while (self->floats[slot] != NULL) {
+        if (self->floats[slot] == literal) return 1;
+        slot = (slot + 1) & (self->float_capacity - 1);
+    }
+    return 0;
+}
+
+// annotate the operators whose operands got the same type the operator
+// has a fast path or an ocaml operator for
+static void typer_annotate(Typer *self) {
+    // a power of two at least twice the number of literals
+    long capacity = 64;
+    while (capacity < self->node_count * 2) capacity *= 2;
+
+    for (long i = 0; i < self->node_count; i++) {
+        AstNode *node = self->nodes[i];
+        int left = typer_kind(self->types[i * 2]);
+        int right = typer_kind(self->types[i * 2 + 1]);
+        int type = left == right ? left : TYPE_ANY;
+
+        if (node->type == AST_NUMBER || node->type == AST_INTEGER) {
+            if (type != TYPE_FLOAT) continue;
+            if (self->float_capacity == 0) {
+                self->float_capacity = capacity;
+                self->floats = calloc(capacity, sizeof(struct AstNode *));
+            }
+            typer_add_float(self, node);
+            continue;
+        }
+
+        self->operators++;
+        if (!self->integral) {
+            int op = node->type == AST_BINOP ? node->binop.op : TOKEN_MINUS;
+            int logic = op == TOKEN_AND || op == TOKEN_OR;
+            if (type != (logic ? TYPE_BOOL : TYPE_NUM)) continue;
+        } else if (type != TYPE_INT && type != TYPE_FLOAT &&
+                   type != TYPE_STR && type != TYPE_BOOL) {
+            continue;
+        }
+
+        self->specialised++;
+        if (node->type == AST_BINOP) node->binop.operands = type;
+        else node->unop.operand = type;
+    }
+}
+
+void typer_infer_prog(Typer *self, AstNode **root, int count) {
+    for (int i = 0; i < count; i++) typer_count(self, root[i]);
+    for (int i = 0; i < count; i++) typer_infer(self, root[i]);
+    typer_annotate(self);
+}
+
+// print a type, with ocaml's notation for fns. 'nested' parenthesizes a
+// fn, as a param of another one is. vars are named in the order they're
+// met, 'copies' is reused to remember them
+static void typer_print(Typer *self, Type *type, int nested) {
+    static const char *names[] = {
+        "any", "num", "int", "float", "bool", "string", "nil", "unit"
+    };
+    type = typer_find(type);
+
+    if (type->kind == TYPE_VAR) {
+        if (type->numeric) {
+            printf("int");
+            return;
+        }
+        int index = 0;
+        while (index < self->copy_count && self->copies[index] != type) {
+            index++;
+        }
+        if (index == self->copy_count) {
+            if (self->copy_count == self->copy_capacity) {
+                self->copy_capacity = self->copy_capacity * 2 + 16;
+                self->copies = realloc(self->copies,
+                    self->copy_capacity * sizeof(struct Type *));
+            }
+            self->copies[self->copy_count++] = type;
+        }
+        printf("'%c", 'a' + index % 26);
+        return;
+    }
+    if (type->kind != TYPE_FN) {
+        printf("%s", names[type->kind]);
+        return;
+    }
+
+    if (nested) printf("(");
+    if (type->param_count == 0) printf("unit -> ");
+    for (int i = 0; i < type->param_count; i++) {
+        typer_print(self, type->params[i], 1);
+        printf(" -> ");
+    }
+    typer_print(self, type->params[type->param_count], 0);
+    if (nested) printf(")");
+}
+
+void typer_print_types(Typer *self) {
+    for (long i = 0; i < self->global_count; i++) {
+        self->copy_count = 0;
+        printf("%s : ", self->globals[i].name);
+        typer_print(self, self->globals[i].type, 0);
+        printf("\n");
+    }
+
+    fflush(stdout);
+    fprintf(stderr, "types: %ld of %ld operators specialised\n",
+            self->specialised, self->operators);
+}
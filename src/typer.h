@@ -0,0 +1,107 @@
+#ifndef TYPER_H
+#define TYPER_H
+
+#include "ast.h"
+#include "arena.h"
+#include "intern.h"
+
+// types the typer proves the operands of an operator have, stored in the
+// operator node. TYPE_ANY when nothing is proven, as for every node the
+// typer didn't see. the engines skip the tag checks of operands that are
+// TYPE_NUM or TYPE_BOOL, the transpiler picks ocaml's operators by them
+enum {
+    TYPE_ANY, TYPE_NUM, TYPE_INT, TYPE_FLOAT, TYPE_BOOL, TYPE_STR,
+    TYPE_NIL, TYPE_UNIT, TYPE_FN, TYPE_VAR
+};
+
+// a type term. a var bound by unification links to the type it stands
+// for. 'level' is the let nesting a var was made at, vars above 0 are
+// generalized once their top level let is typed. 'numeric' marks a var
+// that has to be a number, the type of an integral literal in ocaml
+typedef struct Type {
+    int kind;
+    int level;
+    int numeric;
+    int param_count;
+    struct Type *link;
+    // of a fn, its params and then its result
+    struct Type **params;
+} Type;
+
+// a name top level lets bind. bound once and read by no form before its
+// let, a fn gets a polymorphic type each read instantiates
+typedef struct Global {
+    char *name;
+    Type *type;
+    int bindings;
+    int bound;
+    int used;
+    int generic;
+} Global;
+
+// a name bound by a block or the params of a fn, with a type of its own.
+// a block let is visible to the block from the let on
+typedef struct Local {
+    char *name;
+    Type *type;
+    int visible;
+} Local;
+
+// hindley milner inference over the whole program, run after the
+// optimizer and before the resolver. the language is dynamic, so a type
+// that fails to unify becomes TYPE_ANY, and with it what flows into it:
+// the params and result of a fn, what a call of an unknown fn is given.
+// only what is proven for every run is annotated, so an operator keeps
+// its checks unless every value it can see has the type. with
+// 'integral' set numbers are ocaml's ints and floats, which never mix
+typedef struct Typer {
+    Arena *arena;
+    int integral;
+    int level;
+    // top level lets, and their indexes by name
+    Global *globals;
+    long global_count;
+    long global_capacity;
+    SymbolTable names;
+    // names in scope around the node being typed, innermost last
+    Local *locals;
+    int local_count;
+    int local_capacity;
+    // blocks and fns around the node, lets outside of them are global
+    int scopes;
+    // first local of the innermost fn. the fn sees all the lets of the
+    // blocks around it, so they can call each other
+    int fn_mark;
+    // vars of a polymorphic type and their copies, while it's instantiated
+    Type **copies;
+    int copy_count;
+    int copy_capacity;
+    // names of the builtins, which aren't typed
+    char *puts;
+    char *gets;
+    // operators and, when integral, number literals to annotate once
+    // every form is typed. 'types' holds two for each, the operands'
+    AstNode **nodes;
+    Type **types;
+    long node_count;
+    long node_capacity;
+    // integral literals that turned out floats, an open addressing set
+    AstNode **floats;
+    long float_capacity;
+    // counters for --dump-types
+    long operators;
+    long specialised;
+} Typer;
+
+// init new typer
+Typer typer_init(int integral);
+// infer the types of a whole program and annotate its operators
+void typer_infer_prog(Typer *self, AstNode **root, int count);
+// check if an integral number literal is a float in ocaml
+int typer_is_float(Typer *self, AstNode *literal);
+// print the type of each name top level lets bind and the counters
+void typer_print_types(Typer *self);
+// free the typer, the annotations stay in the nodes
+void typer_free(Typer *self);
+
+#endif
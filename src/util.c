@@ -0,0 +1,12 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "util.h"
+
+void *util_grow(void *array, long capacity, size_t size) {
+    array = realloc(array, capacity * size);
+    if (array == NULL) {
+        puts("out of memory");
+        exit(1);
+    }
+    return array;
+}
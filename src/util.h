@@ -0,0 +1,10 @@
+#ifndef UTIL_H
+#define UTIL_H
+
+#include <stddef.h>
+
+// grow 'array' of 'size' byte items to hold 'capacity' items, exits when
+// out of memory
+void *util_grow(void *array, long capacity, size_t size);
+
+#endif
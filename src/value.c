@@ -0,0 +1,91 @@
+#include "value.h"
+#include "gc.h"
+
+Value value_init_str(const char *chars, int length) {
+    String *string = (String *)gc_alloc(
+        OBJ_STRING, sizeof(struct String) + length + 1);
+
+    string->length = length;
+    memcpy(string->chars, chars, length);
+    string->chars[length] = '\0';
+
+    return VALUE_OBJ(string);
+}
+
+Value value_init_int(int64_t integer) {
+    // made in the middle of an operator, whose operands only its engine
+    // holds, so it can't collect
+    Integer *boxed = (Integer *)gc_alloc_quiet(
+        OBJ_INT, sizeof(struct Integer));
+
+    boxed->value = integer;
+
+    return VALUE_OBJ(boxed);
+}
+
+Value value_init_closure(AstNode *fn, struct Env *env) {
+    Closure *closure = (Closure *)gc_alloc(
+        OBJ_CLOSURE, sizeof(struct Closure));
+
+    closure->fn = fn;
+    closure->env = env;
+    closure->name = NULL;
+    closure->code = NULL;
+
+    return VALUE_OBJ(closure);
+}
+
+Value value_init_cfn(char *name, Builtin cfun_ptr) {
+    Cfn *cfn = (Cfn *)gc_alloc(OBJ_CFN, sizeof(struct Cfn));
+
+    cfn->name = name;
+    cfn->cfun_ptr = cfun_ptr;
+
+    return VALUE_OBJ(cfn);
+}
+
+Value value_init_cell(Value value) {
+    Cell *cell = (Cell *)gc_alloc(OBJ_CELL, sizeof(struct Cell));
+
+    cell->value = value;
+
+    return VALUE_OBJ(cell);
+}
+
+Value value_of_literal(AstNode *node) {
+    switch (node->type) {
+        case AST_NUMBER:
+            return value_num(node->value.num_value);
+        case AST_INTEGER:
+            return value_int(node->value.int_value);
+        case AST_STRING:
+            return value_init_str(
+                node->value.str_value, strlen(node->value.str_value));
+        case AST_BOOL:
+            return VALUE_BOOL(node->value.bool_value);
+        case AST_NIL:
+            return VALUE_NIL;
+        default:
+            return VALUE_NOOP;
+    }
+}
+
+int value_equal(Value left, Value right) {
+    if (VALUE_IS_NUM(left) && VALUE_IS_NUM(right)) {
+        return value_as_num(left) == value_as_num(right);
+    }
+    if (value_is_int(left) && value_is_int(right)) {
+        return value_as_int(left) == value_as_int(right);
+    }
+    if ((VALUE_IS_NUM(left) || value_is_int(left)) &&
+        (VALUE_IS_NUM(right) || value_is_int(right))) {
+        return value_to_num(left) == value_to_num(right);
+    }
+    if (VALUE_IS(left, OBJ_STRING) && VALUE_IS(right, OBJ_STRING)) {
+        String *l = VALUE_AS_STRING(left);
+        String *r = VALUE_AS_STRING(right);
+        return l->length == r->length &&
+               memcmp(l->chars, r->chars, l->length) == 0;
+    }
+    return left == right;
+}
@@ -0,0 +1,219 @@
+#ifndef VALUE_H
+#define VALUE_H
+
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include "ast.h"
+
+// runtime frame, defined in env.h
+struct Env;
+// code compiled for the vm, defined in compiler.h
+struct Code;
+
+// runtime value, nan boxed in 64 bits. a number is its double. anything
+// else is a quiet nan with all of VALUE_QNAN set, which arithmetic never
+// produces: one of the constants below, an int of 49 bits with VALUE_INT
+// set and the int in the low 49 bits, or with the sign bit also set the
+// address of a heap object in the low 48 bits. a wider int64_t is boxed
+// in an Integer object
+typedef uint64_t Value;
+
+#define VALUE_SIGN ((uint64_t)1 << 63)
+#define VALUE_QNAN ((uint64_t)0x7ffc000000000000)
+#define VALUE_INT  ((uint64_t)1 << 49)
+
+// range of the ints that fit in a value
+#define VALUE_INT_MIN (-((int64_t)1 << 48))
+#define VALUE_INT_MAX (((int64_t)1 << 48) - 1)
+
+// value of a slot or global before it's assigned
+#define VALUE_UNDEFINED (VALUE_QNAN | 0)
+#define VALUE_NIL       (VALUE_QNAN | 1)
+#define VALUE_FALSE     (VALUE_QNAN | 2)
+#define VALUE_TRUE      (VALUE_QNAN | 3)
+// value of forms that have none, like let and puts. prints as nothing
+#define VALUE_NOOP      (VALUE_QNAN | 4)
+// never a program's value, an engine returns it for a call in tail
+// position it left to the fn around it
+#define VALUE_TAIL_CALL (VALUE_QNAN | 5)
+
+#define VALUE_IS_NUM(value) (((value) & VALUE_QNAN) != VALUE_QNAN)
+#define VALUE_IS_SMALL_INT(value) \
+    (((value) & (VALUE_QNAN | VALUE_SIGN | VALUE_INT)) == \
+     (VALUE_QNAN | VALUE_INT))
+#define VALUE_IS_OBJ(value) \
+    (((value) & (VALUE_QNAN | VALUE_SIGN)) == (VALUE_QNAN | VALUE_SIGN))
+#define VALUE_IS(value, object_type) \
+    (VALUE_IS_OBJ(value) && VALUE_AS_OBJ(value)->type == (object_type))
+
+#define VALUE_OBJ(object) \
+    ((Value)(uintptr_t)(object) | VALUE_QNAN | VALUE_SIGN)
+#define VALUE_AS_OBJ(value) \
+    ((Object *)(uintptr_t)((value) & ~(VALUE_QNAN | VALUE_SIGN)))
+#define VALUE_AS_STRING(value) ((String *)VALUE_AS_OBJ(value))
+#define VALUE_AS_CLOSURE(value) ((Closure *)VALUE_AS_OBJ(value))
+#define VALUE_AS_CFN(value) ((Cfn *)VALUE_AS_OBJ(value))
+#define VALUE_AS_CELL(value) ((Cell *)VALUE_AS_OBJ(value))
+#define VALUE_AS_INTEGER(value) ((Integer *)VALUE_AS_OBJ(value))
+
+#define VALUE_BOOL(truth) ((truth) ? VALUE_TRUE : VALUE_FALSE)
+
+// header of every heap object. frames closures can capture, see env.h,
+// are collected like objects but never are values. 'marked' and 'next'
+// belong to the collector, see gc.h
+typedef struct Object {
+    enum {
+        OBJ_STRING, OBJ_CLOSURE, OBJ_CFN, OBJ_CELL, OBJ_INT, OBJ_ENV
+    } type;
+    int marked;
+    struct Object *next;
+} Object;
+
+// type for builtin functions
+typedef Value (*Builtin) (int argc, Value *args);
+
+// null terminated string of 'length' bytes
+typedef struct String {
+    Object object;
+    int length;
+    char chars[];
+} String;
+
+// fn value, a fn node and a frame of the variables it captured, or NULL
+// when it captured none. name is set for printing, code when the vm made
+// it
+typedef struct Closure {
+    Object object;
+    AstNode *fn;
+    struct Env *env;
+    char *name;
+    struct Code *code;
+} Closure;
+
+// builtin c function
+typedef struct Cfn {
+    Object object;
+    char *name;
+    Builtin cfun_ptr;
+} Cfn;
+
+// a variable of a block that closures captured. its slot in the block's
+// frame and in the closures' frames hold the same cell, so a later let of
+// it and a fn calling itself see the value it's bound to. never a value
+// a program gets hold of
+typedef struct Cell {
+    Object object;
+    Value value;
+} Cell;
+
+// an int past the range of the ints that fit in a value
+typedef struct Integer {
+    Object object;
+    int64_t value;
+} Integer;
+
+static inline Value value_num(double num) {
+    Value value;
+    memcpy(&value, &num, sizeof(double));
+    return value;
+}
+
+// the double of a value that is a number
+static inline double value_as_num(Value value) {
+    double num;
+    memcpy(&num, &value, sizeof(double));
+    return num;
+}
+
+// box an int past the range of the ints that fit in a value
+Value value_init_int(int64_t integer);
+
+static inline Value value_int(int64_t integer) {
+    if (integer < VALUE_INT_MIN || integer > VALUE_INT_MAX) {
+        return value_init_int(integer);
+    }
+    return VALUE_QNAN | VALUE_INT | ((uint64_t)integer & (VALUE_INT - 1));
+}
+
+static inline int value_is_int(Value value) {
+    return VALUE_IS_SMALL_INT(value) || VALUE_IS(value, OBJ_INT);
+}
+
+// the int64_t of a value that is an int
+static inline int64_t value_as_int(Value value) {
+    if (VALUE_IS_SMALL_INT(value)) return (int64_t)(value << 15) >> 15;
+    return VALUE_AS_INTEGER(value)->value;
+}
+
+// everything except nil and false is truthy
+static inline int value_truth(Value value) {
+    return value != VALUE_NIL && value != VALUE_FALSE;
+}
+
+// a value as an operand of arithmetic. an int is its double, true and
+// other objects count as 1, other non numbers as 0
+static inline double value_to_num(Value value) {
+    if (VALUE_IS_NUM(value)) return value_as_num(value);
+    if (value_is_int(value)) return (double)value_as_int(value);
+    return value == VALUE_TRUE || VALUE_IS_OBJ(value);
+}
+
+// arithmetic on two ints, done by the engines when both operands are
+// ints. what overflows an int64_t is computed on the doubles of the
+// operands instead. a quotient is an int when the division is exact, a
+// division or remainder by 0 is the double's
+static inline Value value_int_add(int64_t left, int64_t right) {
+    int64_t result;
+    if (__builtin_add_overflow(left, right, &result)) {
+        return value_num((double)left + (double)right);
+    }
+    return value_int(result);
+}
+
+static inline Value value_int_sub(int64_t left, int64_t right) {
+    int64_t result;
+    if (__builtin_sub_overflow(left, right, &result)) {
+        return value_num((double)left - (double)right);
+    }
+    return value_int(result);
+}
+
+static inline Value value_int_mul(int64_t left, int64_t right) {
+    int64_t result;
+    if (__builtin_mul_overflow(left, right, &result)) {
+        return value_num((double)left * (double)right);
+    }
+    return value_int(result);
+}
+
+static inline Value value_int_div(int64_t left, int64_t right) {
+    if (right == -1) return value_int_sub(0, left);
+    if (right != 0 && left % right == 0) return value_int(left / right);
+    return value_num((double)left / (double)right);
+}
+
+static inline Value value_int_mod(int64_t left, int64_t right) {
+    if (right == -1) return value_int(0);
+    if (right == 0) return value_num(fmod((double)left, 0));
+    return value_int(left % right);
+}
+
+// a value negated, as the unary - computes it
+static inline Value value_neg(Value value) {
+    if (value_is_int(value)) return value_int_sub(0, value_as_int(value));
+    return value_num(-value_to_num(value));
+}
+
+// functions to create heap objects
+Value value_init_str(const char *chars, int length);
+Value value_init_closure(AstNode *fn, struct Env *env);
+Value value_init_cfn(char *name, Builtin cfun_ptr);
+Value value_init_cell(Value value);
+// value of a literal node
+Value value_of_literal(AstNode *node);
+// numbers are equal by value, an int and a double as doubles, strings
+// by their bytes, the rest only to themselves
+int value_equal(Value left, Value right);
+
+#endif
@@ -0,0 +1,583 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "vm.h"
+#include "compiler.h"
+#include "gc.h"
+#include "stack.h"
+
+// with gcc the code is direct threaded: every opcode word holds the
+// address of the label that runs it, and each instruction jumps to the
+// next one itself. elsewhere, or built with -DVM_SWITCH, a switch in a
+// loop dispatches them
+#if defined(__GNUC__) && !defined(VM_SWITCH)
+#define VM_THREADED
+#endif
+
+#ifdef VM_THREADED
+#define VM_CASE(name) op_##name:
+#define VM_NEXT() goto *(void *)*ip++
+#else
+#define VM_CASE(name) case OP_##name:
+#define VM_NEXT() goto dispatch
+#endif
+
+// activation of a fn on the vm, or of the top level code. 'base' is the
+// stack index of the callee, where the result goes on return
+struct VmFrame {
+    Code *code;
+    intptr_t *ip;
+    Env *env;
+    int base;
+};
+
+// value stack and frames, grown on calls
+static Value *stack = NULL;
+static int stack_capacity = 0;
+static struct VmFrame *frames = NULL;
+static int frame_capacity = 0;
+
+// the top of the stack, the frame count and the env as of the last
+// instruction that could allocate, for the collector
+static Value *vm_sp = NULL;
+static int vm_frame_count = 0;
+static Env *vm_env = NULL;
+
+#define VM_SYNC() (vm_sp = sp, vm_frame_count = frame_count, vm_env = env)
+
+// labels of the opcodes, and the label that counts a dispatch first
+static const void *const *vm_labels = NULL;
+static const void *vm_count_label = NULL;
+
+// dispatch counts by opcode, and by pairs of consecutive opcodes
+static int counting = 0;
+static long dispatches[OP_COUNT];
+static long pairs[OP_COUNT][OP_COUNT];
+static int previous = OP_RETURN;
+
+void vm_count_dispatches(void) {
+    counting = 1;
+}
+
+static void vm_count(int opcode) {
+    dispatches[opcode]++;
+    pairs[previous][opcode]++;
+    previous = opcode;
+}
+
+// print 'count' counts of 'total' in 'counts' from the largest, with
+// 'name' printing what each one counted
+static void vm_print_counts(
+    long *counts, int count, long total, int limit,
+    void (*name)(int index)) {
+    char *printed = calloc(count, 1);
+
+    for (int n = 0; n < limit; n++) {
+        int top = -1;
+        for (int i = 0; i < count; i++) {
+            if (!printed[i] && counts[i] > 0 &&
+                (top < 0 || counts[i] > counts[top])) {
+                top = i;
+            }
+        }
+        if (top < 0) break;
+
+        printed[top] = 1;
+        fprintf(stderr, "%12ld %6.2f%%  ", counts[top],
+                100.0 * counts[top] / total);
+        name(top);
+    }
+
+    free(printed);
+}
+
+static void vm_print_opcode(int opcode) {
+    fprintf(stderr, "%s\n", compiler_opcode_name(opcode));
+}
+
+static void vm_print_pair(int pair) {
+    fprintf(stderr, "%s %s\n", compiler_opcode_name(pair / OP_COUNT),
+            compiler_opcode_name(pair % OP_COUNT));
+}
+
+void vm_print_dispatches(void) {
+    long total = 0;
+    for (int i = 0; i < OP_COUNT; i++) total += dispatches[i];
+
+    fflush(stdout);
+    fprintf(stderr, "dispatches: %ld\n", total);
+    vm_print_counts(dispatches, OP_COUNT, total, OP_COUNT, vm_print_opcode);
+    fprintf(stderr, "pairs:\n");
+    vm_print_counts(
+        &pairs[0][0], OP_COUNT * OP_COUNT, total, 20, vm_print_pair);
+}
+
+// fill in the words the vm dispatches, labels or opcodes
+static void vm_link(Code *code) {
+    code->words = malloc(code->count * sizeof(intptr_t));
+
+    for (int i = 0; i < code->count;) {
+        int opcode = code->ops[i];
+        int end = i + 1 + compiler_opcode_operands(opcode);
+
+        if (vm_labels == NULL) code->words[i] = opcode;
+        else if (counting) code->words[i] = (intptr_t)vm_count_label;
+        else code->words[i] = (intptr_t)vm_labels[opcode];
+
+        for (i++; i < end; i++) code->words[i] = code->ops[i];
+    }
+}
+
+// mark the values on the stack and the envs of the running frames
+static void vm_mark_roots(void) {
+    if (vm_sp == NULL) return;
+
+    for (Value *value = stack; value < vm_sp; value++) gc_mark_value(*value);
+    for (int i = 0; i < vm_frame_count; i++) {
+        gc_mark_object(&frames[i].env->object);
+    }
+    gc_mark_object(&vm_env->object);
+}
+
+// make room for 'needed' values on the stack, which may move it
+static void vm_reserve(int needed) {
+    if (needed <= stack_capacity) return;
+
+    while (stack_capacity < needed) stack_capacity = stack_capacity * 2 + 256;
+    stack = realloc(stack, stack_capacity * sizeof(Value));
+}
+
+// a load found its variable unbound, 'node' is the variable or the call
+static void vm_unbound(AstNode *node) {
+    if (node->type == AST_FNCALL) {
+        printf("func \"%s\" is not defined on line %d\n",
+               node->fncall.name, node->line);
+    } else {
+        printf("name \"%s\" is not defined on line %d\n",
+               node->var.name, node->line);
+    }
+    exit(1);
+}
+
+// value loaded for a variable, 'node' is the variable or the call
+static Value vm_checked(Value value, AstNode *node) {
+    if (value == VALUE_UNDEFINED) vm_unbound(node);
+    if (VALUE_IS(value, OBJ_CLOSURE) && node->type == AST_VAR) {
+        VALUE_AS_CLOSURE(value)->name = node->var.name;
+    }
+    return value;
+}
+
+// value of a binary operator, as the tree walker computes it: two ints
+// as ints, see value.h, other numbers as doubles and what isn't a number
+// as one of value_to_num. the _NUM opcodes take the values as the numbers
+// the typer proved them, which are equal as doubles, and the _BOOL ones
+// as the bools it proved them. a boxed int it makes can't collect, see
+// value_init_int, so the instructions don't have to sync the stack first
+static Value vm_binop(int opcode, Value left, Value right) {
+    if (opcode == OP_AND_BOOL) {
+        return VALUE_BOOL(left == VALUE_TRUE && right == VALUE_TRUE);
+    }
+    if (opcode == OP_OR_BOOL) {
+        return VALUE_BOOL(left == VALUE_TRUE || right == VALUE_TRUE);
+    }
+
+    int numbers = VALUE_IS_NUM(left) && VALUE_IS_NUM(right);
+
+    if ((VALUE_IS_SMALL_INT(left) && VALUE_IS_SMALL_INT(right)) ||
+        (!numbers && value_is_int(left) && value_is_int(right))) {
+        int64_t l = value_as_int(left);
+        int64_t r = value_as_int(right);
+
+        switch (opcode) {
+            case OP_ADD: case OP_ADD_NUM:       return value_int_add(l, r);
+            case OP_SUB: case OP_SUB_NUM:       return value_int_sub(l, r);
+            case OP_MUL: case OP_MUL_NUM:       return value_int_mul(l, r);
+            case OP_DIV: case OP_DIV_NUM:       return value_int_div(l, r);
+            case OP_MOD: case OP_MOD_NUM:       return value_int_mod(l, r);
+            case OP_LT: case OP_LT_NUM:         return VALUE_BOOL(l < r);
+            case OP_GT: case OP_GT_NUM:         return VALUE_BOOL(l > r);
+            case OP_LTE: case OP_LTE_NUM:       return VALUE_BOOL(l <= r);
+            case OP_GTE: case OP_GTE_NUM:       return VALUE_BOOL(l >= r);
+            case OP_EQUAL: case OP_EQUAL_NUM:   return VALUE_BOOL(l == r);
+            case OP_NEQUAL: case OP_NEQUAL_NUM: return VALUE_BOOL(l != r);
+            case OP_AND:                        return VALUE_BOOL(l && r);
+            default:                            return VALUE_BOOL(l || r);
+        }
+    }
+
+    if (!numbers && opcode == OP_EQUAL) {
+        return VALUE_BOOL(value_equal(left, right));
+    }
+    if (!numbers && opcode == OP_NEQUAL) {
+        return VALUE_BOOL(!value_equal(left, right));
+    }
+
+    double l = value_to_num(left);
+    double r = value_to_num(right);
+
+    switch (opcode) {
+        case OP_ADD: case OP_ADD_NUM:       return value_num(l + r);
+        case OP_SUB: case OP_SUB_NUM:       return value_num(l - r);
+        case OP_MUL: case OP_MUL_NUM:       return value_num(l * r);
+        case OP_DIV: case OP_DIV_NUM:       return value_num(l / r);
+        case OP_MOD: case OP_MOD_NUM:       return value_num(fmod(l, r));
+        case OP_LT: case OP_LT_NUM:         return VALUE_BOOL(l < r);
+        case OP_GT: case OP_GT_NUM:         return VALUE_BOOL(l > r);
+        case OP_LTE: case OP_LTE_NUM:       return VALUE_BOOL(l <= r);
+        case OP_GTE: case OP_GTE_NUM:       return VALUE_BOOL(l >= r);
+        case OP_EQUAL: case OP_EQUAL_NUM:   return VALUE_BOOL(l == r);
+        case OP_NEQUAL: case OP_NEQUAL_NUM: return VALUE_BOOL(l != r);
+        case OP_AND:                        return VALUE_BOOL(l && r);
+        default:                            return VALUE_BOOL(l || r);
+    }
+}
+
+// value of a _NUM operator. two ints that fit in a value and two doubles
+// take no other check, their sum or difference can't overflow. a boxed
+// int or an int and a double go through vm_binop
+static inline Value vm_binop_num(int opcode, Value left, Value right) {
+    if (VALUE_IS_SMALL_INT(left) && VALUE_IS_SMALL_INT(right)) {
+        int64_t l = value_as_int(left);
+        int64_t r = value_as_int(right);
+
+        switch (opcode) {
+            case OP_ADD_NUM:    return value_int(l + r);
+            case OP_SUB_NUM:    return value_int(l - r);
+            case OP_MUL_NUM:    return value_int_mul(l, r);
+            case OP_DIV_NUM:    return value_int_div(l, r);
+            case OP_MOD_NUM:    return value_int_mod(l, r);
+            case OP_LT_NUM:     return VALUE_BOOL(l < r);
+            case OP_GT_NUM:     return VALUE_BOOL(l > r);
+            case OP_LTE_NUM:    return VALUE_BOOL(l <= r);
+            case OP_GTE_NUM:    return VALUE_BOOL(l >= r);
+            case OP_EQUAL_NUM:  return VALUE_BOOL(l == r);
+            default:            return VALUE_BOOL(l != r);
+        }
+    }
+
+    if (VALUE_IS_NUM(left) && VALUE_IS_NUM(right)) {
+        double l = value_as_num(left);
+        double r = value_as_num(right);
+
+        switch (opcode) {
+            case OP_ADD_NUM:    return value_num(l + r);
+            case OP_SUB_NUM:    return value_num(l - r);
+            case OP_MUL_NUM:    return value_num(l * r);
+            case OP_DIV_NUM:    return value_num(l / r);
+            case OP_MOD_NUM:    return value_num(fmod(l, r));
+            case OP_LT_NUM:     return VALUE_BOOL(l < r);
+            case OP_GT_NUM:     return VALUE_BOOL(l > r);
+            case OP_LTE_NUM:    return VALUE_BOOL(l <= r);
+            case OP_GTE_NUM:    return VALUE_BOOL(l >= r);
+            case OP_EQUAL_NUM:  return VALUE_BOOL(l == r);
+            default:            return VALUE_BOOL(l != r);
+        }
+    }
+    return vm_binop(opcode, left, right);
+}
+
+// a binary operator on the top two values
+#define VM_BINOP(name) \
+    VM_CASE(name) \
+        sp--; \
+        sp[-1] = vm_binop(OP_##name, sp[-1], sp[0]); \
+        VM_NEXT();
+
+#define VM_BINOP_NUM(name) \
+    VM_CASE(name) \
+        sp--; \
+        sp[-1] = vm_binop_num(OP_##name, sp[-1], sp[0]); \
+        VM_NEXT();
+
+#define VM_LABEL(name, operands) &&op_##name,
+
+// run 'code' as the top level code until it returns
+static Value vm_run(Code *code, Env *globals) {
+    int frame_count = 0;
+    struct VmFrame *frame;
+    Value *sp;
+    intptr_t *ip;
+    Env *env = globals;
+    // operands of a call, set before going to 'call'. a tail call takes
+    // the place of the running fn
+    int arg_count;
+    AstNode *node;
+    int tail;
+    // value of the running fn, set before going to 'return_result'
+    Value result;
+
+#ifdef VM_THREADED
+    static const void *const labels[OP_COUNT] = {
+        COMPILER_OPCODES(VM_LABEL)
+    };
+    vm_labels = labels;
+    vm_count_label = &&count;
+#endif
+
+    if (code->words == NULL) vm_link(code);
+    ip = code->words;
+    vm_reserve(code->max_stack);
+    sp = stack;
+
+#ifdef VM_THREADED
+    VM_NEXT();
+
+count: {
+        int opcode = code->ops[ip - 1 - code->words];
+        vm_count(opcode);
+        goto *labels[opcode];
+    }
+#else
+dispatch:
+    if (counting) vm_count(*ip);
+    switch (*ip++) {
+#endif
+
+    VM_CASE(CONST)
+        *sp++ = code->constants[*ip++];
+        VM_NEXT();
+    VM_CASE(POP)
+        sp--;
+        VM_NEXT();
+    VM_CASE(LOAD_LOCAL)
+        *sp++ = vm_checked(env->slots[ip[0]], code->nodes[ip[1]]);
+        ip += 2;
+        VM_NEXT();
+    VM_CASE(LOAD_OUTER) {
+        Env *outer = env;
+        for (int i = ip[0]; i > 0; i--) outer = outer->parent;
+        *sp++ = vm_checked(outer->slots[ip[1]], code->nodes[ip[2]]);
+        ip += 3;
+        VM_NEXT();
+    }
+    VM_CASE(LOAD_GLOBAL)
+        node = code->nodes[*ip++];
+        *sp++ = vm_checked(env_find_var(globals, node->type == AST_FNCALL
+            ? node->fncall.name : node->var.name), node);
+        VM_NEXT();
+    VM_CASE(LOAD_CELL) {
+        Env *outer = env;
+        for (int i = ip[0]; i > 0; i--) outer = outer->parent;
+        Value value = outer->slots[ip[1]];
+
+        if (VALUE_IS(value, OBJ_CELL)) value = VALUE_AS_CELL(value)->value;
+        *sp++ = vm_checked(value, code->nodes[ip[2]]);
+        ip += 3;
+        VM_NEXT();
+    }
+    VM_CASE(STORE_LOCAL)
+        env->slots[*ip++] = *--sp;
+        VM_NEXT();
+    VM_CASE(STORE_CELL) {
+        Value *slot = &env->slots[*ip++];
+
+        if (VALUE_IS(*slot, OBJ_CELL)) VALUE_AS_CELL(*slot)->value = *--sp;
+        else *slot = *--sp;
+        VM_NEXT();
+    }
+    VM_CASE(STORE_GLOBAL)
+        env_insert_var(&globals, code->nodes[*ip++]->var.name, *--sp);
+        VM_NEXT();
+    VM_BINOP(ADD) VM_BINOP(SUB) VM_BINOP(MUL) VM_BINOP(DIV) VM_BINOP(MOD)
+    VM_BINOP(LT) VM_BINOP(GT) VM_BINOP(LTE) VM_BINOP(GTE)
+    VM_BINOP(EQUAL) VM_BINOP(NEQUAL) VM_BINOP(AND) VM_BINOP(OR)
+    VM_CASE(NEG)
+        sp[-1] = value_neg(sp[-1]);
+        VM_NEXT();
+    VM_BINOP_NUM(ADD_NUM) VM_BINOP_NUM(SUB_NUM) VM_BINOP_NUM(MUL_NUM)
+    VM_BINOP_NUM(DIV_NUM) VM_BINOP_NUM(MOD_NUM) VM_BINOP_NUM(LT_NUM)
+    VM_BINOP_NUM(GT_NUM) VM_BINOP_NUM(LTE_NUM) VM_BINOP_NUM(GTE_NUM)
+    VM_BINOP_NUM(EQUAL_NUM) VM_BINOP_NUM(NEQUAL_NUM)
+    VM_BINOP(AND_BOOL) VM_BINOP(OR_BOOL)
+    VM_CASE(NEG_NUM)
+        sp[-1] = VALUE_IS_NUM(sp[-1]) ? value_num(-value_as_num(sp[-1]))
+                                      : value_neg(sp[-1]);
+        VM_NEXT();
+    VM_CASE(NOT)
+        sp[-1] = VALUE_BOOL(!value_truth(sp[-1]));
+        VM_NEXT();
+    VM_CASE(JUMP)
+        ip = code->words + *ip;
+        VM_NEXT();
+    VM_CASE(JUMP_IF_FALSE)
+        if (value_truth(*--sp)) ip++;
+        else ip = code->words + *ip;
+        VM_NEXT();
+    VM_CASE(CLOSURE) {
+        Code *fn = code->fns[*ip++];
+        VM_SYNC();
+        Value closure = env_capture(env, fn->fn);
+
+        VALUE_AS_CLOSURE(closure)->code = fn;
+        *sp++ = closure;
+        VM_NEXT();
+    }
+    VM_CASE(ENTER)
+        env = env_push_frame(env, *ip++);
+        VM_NEXT();
+    VM_CASE(LEAVE) {
+        Env *block = env;
+
+        env = env->parent;
+        env_pop_frame(block);
+        VM_NEXT();
+    }
+    VM_CASE(CALL)
+        arg_count = ip[0];
+        node = code->nodes[ip[1]];
+        ip += 2;
+        tail = 0;
+        goto call;
+    VM_CASE(TAIL_CALL)
+        arg_count = ip[0];
+        node = code->nodes[ip[1]];
+        ip += 2;
+        tail = 1;
+    call: {
+        Value *args = sp - arg_count;
+
+        // the callee and args stay on the stack while anything allocates
+        VM_SYNC();
+        gc_safepoint();
+
+        if (VALUE_IS(args[-1], OBJ_CFN)) {
+            result = VALUE_AS_CFN(args[-1])->cfun_ptr(arg_count, args);
+            if (tail) goto return_result;
+            sp = args;
+            sp[-1] = result;
+            VM_NEXT();
+        }
+
+        if (!VALUE_IS(args[-1], OBJ_CLOSURE)) {
+            printf("value called on line %d is not a function\n",
+                   node->line);
+            exit(1);
+        }
+
+        Closure *callee = VALUE_AS_CLOSURE(args[-1]);
+        AstNode *fn = callee->fn;
+        if (arg_count != fn->fn.param_count) {
+            printf(
+                "invalid number of arguments. fn takes %d args, "
+                "%d given\n", fn->fn.param_count, arg_count);
+            exit(1);
+        }
+
+        // closures kept across repl lines are compiled again
+        if (callee->code == NULL) callee->code = compiler_init_fn(fn);
+        Code *callee_code = callee->code;
+        if (!callee_code->compiled) compiler_compile_fn(callee_code);
+        if (callee_code->words == NULL) vm_link(callee_code);
+
+        // a tail call returns to the caller of the running fn first, its
+        // frame is dropped and the callee and args move down to where
+        // the running fn was called
+        if (tail) {
+            frame = &frames[frame_count - 1];
+            env_pop_frame(env);
+            env = frame->env;
+            memmove(stack + frame->base, args - 1,
+                    (arg_count + 1) * sizeof(Value));
+            args = stack + frame->base + 1;
+            sp = args + arg_count;
+            VM_SYNC();
+        } else {
+            if (frame_count >= stack_max_depth && stack_max_depth > 0) {
+                stack_overflow(node->line);
+            }
+            if (frame_count == frame_capacity) {
+                frame_capacity = frame_capacity * 2 + 64;
+                frames = realloc(
+                    frames, frame_capacity * sizeof(struct VmFrame));
+            }
+            frame = &frames[frame_count++];
+            frame->code = code;
+            frame->ip = ip;
+            frame->env = env;
+            frame->base = args - 1 - stack;
+        }
+
+        Env *local_env = env_push_frame(callee->env, arg_count);
+        for (int i = 0; i < arg_count; i++) {
+            local_env->slots[i] = args[i];
+        }
+
+        int base = frame->base;
+        vm_reserve(base + 1 + callee_code->max_stack);
+        sp = stack + base + 1;
+
+        code = callee_code;
+        ip = code->words;
+        env = local_env;
+        VM_NEXT();
+    }
+    VM_CASE(RETURN)
+        result = *--sp;
+    return_result:
+        if (frame_count == 0) {
+            vm_sp = NULL;
+            return result;
+        }
+
+        env_pop_frame(env);
+        frame = &frames[--frame_count];
+        code = frame->code;
+        ip = frame->ip;
+        env = frame->env;
+        sp = stack + frame->base;
+        *sp++ = result;
+        VM_NEXT();
+
+    // superinstructions, the operands of the fused instructions are at
+    // their own offsets: a LOAD_LOCAL's slot and node at ip[0] and ip[1],
+    // and the next instruction's opcode at ip[2]
+    VM_CASE(TEST_LOCAL_CONST) {
+        Value left = vm_checked(env->slots[ip[0]], code->nodes[ip[1]]);
+
+        if (vm_binop(ip[4], left, code->constants[ip[3]]) == VALUE_TRUE) {
+            ip += 7;
+        } else {
+            ip = code->words + ip[6];
+        }
+        VM_NEXT();
+    }
+    VM_CASE(ARITH_LOCAL_CONST)
+        *sp++ = vm_binop(ip[4],
+            vm_checked(env->slots[ip[0]], code->nodes[ip[1]]),
+            code->constants[ip[3]]);
+        ip += 5;
+        VM_NEXT();
+    VM_CASE(CALL_ARITH_LOCAL_CONST)
+        *sp++ = vm_binop(ip[4],
+            vm_checked(env->slots[ip[0]], code->nodes[ip[1]]),
+            code->constants[ip[3]]);
+        arg_count = 1;
+        node = code->nodes[ip[7]];
+        ip += 8;
+        tail = 0;
+        goto call;
+    VM_CASE(ARITH_LOCAL_LOCAL) {
+        Value left = vm_checked(env->slots[ip[0]], code->nodes[ip[1]]);
+        Value right = vm_checked(env->slots[ip[3]], code->nodes[ip[4]]);
+
+        *sp++ = vm_binop(ip[5], left, right);
+        ip += 6;
+        VM_NEXT();
+    }
+
+#ifndef VM_THREADED
+    }
+    return VALUE_NOOP;
+#endif
+}
+
+Value vm_run_prog(AstNode **root, int child_count, Env *env) {
+    static int marking = 0;
+
+    if (!marking) {
+        gc_add_marker(vm_mark_roots);
+        marking = 1;
+    }
+    return vm_run(compiler_compile_prog(root, child_count), env);
+}
@@ -0,0 +1,14 @@
+#ifndef VM_H
+#define VM_H
+
+#include "env.h"
+
+// compile the top level forms of a program and run them on the vm, with
+// 'env' as the global env. returns the value of the last form
+Value vm_run_prog(AstNode **root, int child_count, Env *env);
+// count every instruction dispatched from now on
+void vm_count_dispatches(void);
+// print the dispatch counts of each opcode and pair of opcodes to stderr
+void vm_print_dispatches(void);
+
+#endif
@@ -0,0 +1,19 @@
+#!/bin/sh
+# run every tests/*.scc and compare what it prints with the .out file next
+# to it. run from the repo root after make, the command defaults to
+# ./scc and may carry options:
+#   ./tests/run.sh ["./scc --lazy"]
+scc=${1:-./scc}
+failed=0
+
+for test in tests/*.scc; do
+    expected=${test%.scc}.out
+    if ! $scc "$test" 2>/dev/null | cmp -s - "$expected"; then
+        echo "FAIL: $scc $test"
+        $scc "$test" 2>/dev/null | diff "$expected" - | head -20
+        failed=$((failed + 1))
+    fi
+done
+
+[ "$failed" -eq 0 ] && echo "$scc: all tests passed"
+exit "$failed"